@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+#
+# Writes a tree of synthetic Xcursor themes for the startup benchmark:
+#
+#   make-cursor-corpus.py DIR [--themes N] [--sizes 24,32,48] [--frames N]
+#
+# Point XCURSOR_PATH at DIR. Every theme ships the cursors the preview
+# shows, one file per cursor at each nominal size, plus an animated
+# left_ptr_watch, so the scan, the analysis and the previews do real work.
+
+import argparse
+import os
+import struct
+
+XCURSOR_MAGIC = b"Xcur"
+XCURSOR_FILE_HEADER = 16
+XCURSOR_FILE_VERSION = 0x10000
+XCURSOR_TOC_ENTRY = 12
+XCURSOR_IMAGE_TYPE = 0xfffd0002
+XCURSOR_IMAGE_HEADER = 36
+XCURSOR_IMAGE_VERSION = 1
+
+# the names of src/populate-cursors.c, without duplicates
+CURSORS = [
+    "left_ptr", "left_ptr_watch", "watch", "hand2", "question_arrow",
+    "sb_h_double_arrow", "sb_v_double_arrow", "bottom_left_corner",
+    "bottom_right_corner", "fleur", "pirate", "cross", "X_cursor",
+    "right_ptr", "right_side", "right_tee", "sb_right_arrow", "sb_right_tee",
+    "base_arrow_down", "base_arrow_up", "bottom_side", "bottom_tee",
+    "center_ptr", "circle", "dot", "dot_box_mask", "double_arrow",
+    "draped_box", "left_side", "left_tee", "ll_angle", "top_side", "top_tee",
+]
+
+ANIMATED = ("left_ptr_watch", "watch")
+
+
+def image(size, frame, n_frames, seed):
+    """One premultiplied ARGB square, a different shade per frame."""
+    shade = (seed * 37 + frame * 255 // max(n_frames, 1)) & 0xff
+    pixel = struct.pack("<I", 0xff000000 | shade << 16 | (255 - shade) << 8 | 0x40)
+    header = struct.pack("<9I", XCURSOR_IMAGE_HEADER, XCURSOR_IMAGE_TYPE, size,
+                         XCURSOR_IMAGE_VERSION, size, size, size // 4, size // 4,
+                         50 if n_frames > 1 else 0)
+    return header + pixel * (size * size)
+
+
+def write_cursor(path, sizes, n_frames, seed):
+    chunks = [(size, image(size, frame, n_frames, seed))
+              for size in sizes for frame in range(n_frames)]
+
+    position = XCURSOR_FILE_HEADER + XCURSOR_TOC_ENTRY * len(chunks)
+    toc = b""
+    for size, chunk in chunks:
+        toc += struct.pack("<3I", XCURSOR_IMAGE_TYPE, size, position)
+        position += len(chunk)
+
+    with open(path, "wb") as f:
+        f.write(XCURSOR_MAGIC)
+        f.write(struct.pack("<3I", XCURSOR_FILE_HEADER, XCURSOR_FILE_VERSION, len(chunks)))
+        f.write(toc)
+        for _, chunk in chunks:
+            f.write(chunk)
+
+
+def write_theme(basedir, index, sizes, n_frames):
+    name = "corpus-%04d" % index
+    cursors = os.path.join(basedir, name, "cursors")
+    os.makedirs(cursors, exist_ok=True)
+
+    with open(os.path.join(basedir, name, "index.theme"), "w") as f:
+        f.write("[Icon Theme]\nName=Corpus %d\nComment=Synthetic cursor theme %d\n"
+                % (index, index))
+
+    for seed, cursor in enumerate(CURSORS):
+        frames = n_frames if cursor in ANIMATED else 1
+        write_cursor(os.path.join(cursors, cursor), sizes, frames, index + seed)
+
+    # most real themes alias many names to a few files
+    for alias, target in (("default", "left_ptr"), ("arrow", "left_ptr"),
+                          ("progress", "left_ptr_watch"), ("wait", "watch")):
+        link = os.path.join(cursors, alias)
+        if not os.path.lexists(link):
+            os.symlink(target, link)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write synthetic Xcursor themes.")
+    parser.add_argument("dir")
+    parser.add_argument("--themes", type=int, default=20)
+    parser.add_argument("--sizes", default="24,32,48")
+    parser.add_argument("--frames", type=int, default=12)
+    args = parser.parse_args()
+
+    sizes = [int(size) for size in args.sizes.split(",")]
+    for index in range(args.themes):
+        write_theme(args.dir, index, sizes, args.frames)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# Time to first frame under a stand-in desktop: a private Xvfb display, a
+# private session bus and memory-backed GSettings, with XCURSOR_PATH on
+# generated theme trees of each requested size.
+#
+#   startup-bench.sh [-b BINARY] [-r RUNS] [-t "0 20 200"]
+#
+# Prints one JSON line per run, from --startup-bench, tagged with the
+# number of themes in the corpus.
+
+set -e
+
+srcdir=$(cd "$(dirname "$0")/.." && pwd)
+binary="$srcdir/src/huayra-accessibility-settings"
+runs=5
+corpora="0 20 200"
+
+while getopts b:r:t: opt; do
+	case $opt in
+	b) binary=$OPTARG ;;
+	r) runs=$OPTARG ;;
+	t) corpora=$OPTARG ;;
+	*) echo "usage: $0 [-b BINARY] [-r RUNS] [-t \"THEMES...\"]" >&2; exit 2 ;;
+	esac
+done
+
+for tool in Xvfb dbus-run-session python3; do
+	if ! command -v $tool >/dev/null 2>&1; then
+		echo "$0: $tool is required" >&2
+		exit 77
+	fi
+done
+
+workdir=$(mktemp -d)
+xvfb_pid=
+
+cleanup () {
+	[ -n "$xvfb_pid" ] && kill $xvfb_pid 2>/dev/null || true
+	rm -rf "$workdir"
+}
+trap cleanup EXIT INT TERM
+
+# Xvfb picks a free display and writes its number once it accepts clients.
+Xvfb -displayfd 3 -screen 0 1280x1024x24 -nolisten tcp 3>"$workdir/display" 2>/dev/null &
+xvfb_pid=$!
+while [ ! -s "$workdir/display" ]; do
+	kill -0 $xvfb_pid 2>/dev/null || { echo "$0: Xvfb failed" >&2; exit 1; }
+	sleep 0.1
+done
+DISPLAY=:$(cat "$workdir/display")
+export DISPLAY
+
+for themes in $corpora; do
+	corpus="$workdir/corpus-$themes"
+	mkdir -p "$corpus"
+	python3 "$srcdir/scripts/make-cursor-corpus.py" "$corpus" --themes "$themes"
+
+	run=1
+	while [ $run -le "$runs" ]; do
+		# A fresh home each run, nothing is cached across runs.
+		home="$workdir/home-$themes-$run"
+		mkdir -p "$home"
+
+		line=$(HOME="$home" XDG_CACHE_HOME="$home/.cache" \
+		       XDG_CONFIG_HOME="$home/.config" \
+		       GSETTINGS_BACKEND=memory XCURSOR_PATH="$corpus" \
+		       dbus-run-session -- "$binary" --startup-bench | tail -n 1)
+
+		echo "$line" | sed "s/^{/{\"corpus_themes\":$themes,\"run\":$run,/"
+		run=$((run + 1))
+	done
+done
@@ -0,0 +1,125 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include "a11y-actions.h"
+#include "a11y-bus.h"
+#include "a11y-settings.h"
+
+static const struct {
+	const gchar *name;
+	A11yOption   option;
+	const gchar *parameter_type;
+} actions[] = {
+	{ "high-contrast", A11Y_OPTION_HIGH_CONTRAST, NULL },
+	{ "large-print",   A11Y_OPTION_LARGE_PRINT,   NULL },
+	{ "screen-reader", A11Y_OPTION_SCREEN_READER, NULL },
+	{ "keyboard",      A11Y_OPTION_KEYBOARD,      NULL },
+	{ "cursor-theme",  A11Y_OPTION_CURSOR_THEME,  "s" }
+};
+
+static void
+a11y_action_bus_done (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	GError *error = NULL;
+
+	/* Read again, another change may have come in meanwhile. */
+	if (a11y_bus_set_enabled_finish (result, &error)) {
+		a11y_bus_start_helpers (a11y_option_get_boolean (A11Y_OPTION_SCREEN_READER),
+		                        a11y_option_get_boolean (A11Y_OPTION_KEYBOARD));
+	}
+	else {
+		g_message ("Can't reach the accessibility bus: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_application_release (g_application_get_default ());
+}
+
+static void
+a11y_action_change_state (GSimpleAction *action,
+                          GVariant      *value,
+                          gpointer       user_data)
+{
+	A11yOption option = GPOINTER_TO_UINT (user_data);
+	gboolean need_at;
+
+	a11y_option_apply (option, value);
+
+	/* Assistive technologies need the accessibility bus, in the running
+	 * session too, like the dialog does on Aceptar. */
+	if (option == A11Y_OPTION_SCREEN_READER || option == A11Y_OPTION_KEYBOARD) {
+		need_at = a11y_option_get_boolean (A11Y_OPTION_SCREEN_READER) ||
+		          a11y_option_get_boolean (A11Y_OPTION_KEYBOARD);
+		a11y_settings_set_accessibility (need_at);
+
+		g_application_hold (g_application_get_default ());
+		a11y_bus_set_enabled (need_at, NULL, a11y_action_bus_done, NULL);
+	}
+
+	g_simple_action_set_state (action, value);
+}
+
+/* Follow changes made by the dialog or anyone else. */
+
+static void
+a11y_actions_settings_changed (GSettings   *settings,
+                               const gchar *key,
+                               GActionMap  *map)
+{
+	GAction *action;
+	GVariant *state;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (actions); i++) {
+		action = g_action_map_lookup_action (map, actions[i].name);
+
+		state = a11y_option_query (actions[i].option);
+		g_simple_action_set_state (G_SIMPLE_ACTION (action), state);
+		g_variant_unref (state);
+	}
+}
+
+void
+a11y_actions_register (GActionMap *map)
+{
+	GSimpleAction *action;
+	GVariant *state;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (actions); i++) {
+		state = a11y_option_query (actions[i].option);
+		action = g_simple_action_new_stateful (actions[i].name,
+		                                       actions[i].parameter_type ?
+		                                       G_VARIANT_TYPE (actions[i].parameter_type) : NULL,
+		                                       state);
+		g_variant_unref (state);
+
+		g_signal_connect (action, "change-state",
+		                  G_CALLBACK (a11y_action_change_state),
+		                  GUINT_TO_POINTER (actions[i].option));
+
+		g_action_map_add_action (map, G_ACTION (action));
+		g_object_unref (action);
+	}
+
+	for (i = 0; i < N_A11Y_SCHEMAS; i++)
+		g_signal_connect_object (a11y_settings_get (i), "changed",
+		                         G_CALLBACK (a11y_actions_settings_changed),
+		                         map, 0);
+}
@@ -0,0 +1,28 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef A11Y_ACTIONS_H
+#define A11Y_ACTIONS_H
+
+#include <gio/gio.h>
+
+/* Stateful actions to toggle the options remotely, e.g. with
+ * gapplication action org.accessibility.huayra high-contrast */
+
+void a11y_actions_register (GActionMap *map);
+
+#endif /* A11Y_ACTIONS_H */
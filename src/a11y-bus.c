@@ -0,0 +1,248 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "a11y-bus.h"
+#include "a11y-settings.h"
+#include "stats.h"
+#include "trace.h"
+
+static GVariant *
+a11y_bus_set_parameters (gboolean enabled)
+{
+	return g_variant_new ("(ssv)", A11Y_STATUS_IFACE, "IsEnabled",
+	                      g_variant_new_boolean (enabled));
+}
+
+static void
+a11y_bus_set_done (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	GTask *task = user_data;
+	GVariant *reply;
+	GError *error = NULL;
+	gint64 *span;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+
+	span = g_task_get_task_data (task);
+	TRACE_END (*span, "dbus", "IsEnabled", A11Y_BUS_NAME);
+	STATS_ADD (STATS_DBUS_CALLS, 1);
+
+	if (reply) {
+		g_variant_unref (reply);
+		g_task_return_boolean (task, TRUE);
+	}
+	else {
+		g_task_return_error (task, error);
+	}
+
+	g_object_unref (task);
+}
+
+static void
+a11y_bus_ready (GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+	GTask *task = user_data;
+	GDBusConnection *connection;
+	GError *error = NULL;
+
+	connection = g_bus_get_finish (result, &error);
+	if (connection == NULL) {
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+
+	/* The launcher is activatable, the call starts it when needed. */
+	g_dbus_connection_call (connection,
+	                        A11Y_BUS_NAME,
+	                        A11Y_BUS_PATH,
+	                        "org.freedesktop.DBus.Properties",
+	                        "Set",
+	                        a11y_bus_set_parameters (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (task), "enabled"))),
+	                        NULL,
+	                        G_DBUS_CALL_FLAGS_NONE,
+	                        A11Y_BUS_TIMEOUT,
+	                        g_task_get_cancellable (task),
+	                        a11y_bus_set_done,
+	                        task);
+
+	g_object_unref (connection);
+}
+
+void
+a11y_bus_set_enabled (gboolean             enabled,
+                      GCancellable        *cancellable,
+                      GAsyncReadyCallback  callback,
+                      gpointer             user_data)
+{
+	GTask *task;
+	gint64 *span;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_object_set_data (G_OBJECT (task), "enabled", GINT_TO_POINTER (enabled));
+
+	span = g_new (gint64, 1);
+	*span = TRACE_BEGIN ();
+	g_task_set_task_data (task, span, g_free);
+
+	g_bus_get (G_BUS_TYPE_SESSION, cancellable, a11y_bus_ready, task);
+}
+
+gboolean
+a11y_bus_set_enabled_finish (GAsyncResult  *result,
+                             GError       **error)
+{
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+gboolean
+a11y_bus_set_enabled_sync (gboolean   enabled,
+                           GError   **error)
+{
+	GDBusConnection *connection;
+	GVariant *reply;
+	gint64 span;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, error);
+	if (connection == NULL)
+		return FALSE;
+
+	span = TRACE_BEGIN ();
+	reply = g_dbus_connection_call_sync (connection,
+	                                     A11Y_BUS_NAME,
+	                                     A11Y_BUS_PATH,
+	                                     "org.freedesktop.DBus.Properties",
+	                                     "Set",
+	                                     a11y_bus_set_parameters (enabled),
+	                                     NULL,
+	                                     G_DBUS_CALL_FLAGS_NONE,
+	                                     A11Y_BUS_TIMEOUT,
+	                                     NULL,
+	                                     error);
+	TRACE_END (span, "dbus", "IsEnabled", A11Y_BUS_NAME);
+	STATS_ADD (STATS_DBUS_CALLS, 1);
+
+	g_object_unref (connection);
+
+	if (reply == NULL)
+		return FALSE;
+
+	g_variant_unref (reply);
+	return TRUE;
+}
+
+/* The session starts the helpers from the startup keys only at login, so
+ * a helper wanted now is started here unless it already runs. */
+
+static gboolean
+a11y_bus_helper_is_running (const gchar *program)
+{
+	GDir *proc;
+	const gchar *pid;
+	gchar *path, *comm, *name;
+	GStatBuf st;
+	uid_t uid;
+	gboolean running = FALSE;
+
+	proc = g_dir_open ("/proc", 0, NULL);
+	if (proc == NULL)
+		return FALSE;
+
+	/* comm holds at most 15 characters of the name. */
+	name = g_path_get_basename (program);
+	if (strlen (name) > 15)
+		name[15] = '\0';
+
+	/* Helpers of other users on the same machine don't serve us. */
+	uid = getuid ();
+
+	while (!running && (pid = g_dir_read_name (proc)) != NULL) {
+		if (!g_ascii_isdigit (pid[0]))
+			continue;
+
+		path = g_build_filename ("/proc", pid, NULL);
+		if (g_stat (path, &st) != 0 || st.st_uid != uid) {
+			g_free (path);
+			continue;
+		}
+		g_free (path);
+
+		path = g_build_filename ("/proc", pid, "comm", NULL);
+		if (g_file_get_contents (path, &comm, NULL, NULL)) {
+			g_strchomp (comm);
+			running = (g_strcmp0 (comm, name) == 0);
+			g_free (comm);
+		}
+		g_free (path);
+	}
+
+	g_free (name);
+	g_dir_close (proc);
+
+	return running;
+}
+
+static void
+a11y_bus_start_helper (A11ySchema   schema,
+                       const gchar *schema_id,
+                       const gchar *key)
+{
+	gchar *exec, **argv = NULL;
+	GError *error = NULL;
+
+	exec = g_settings_get_string (a11y_settings_get (schema), key);
+	STATS_SETTINGS_READ (schema_id);
+
+	if (!g_shell_parse_argv (exec, NULL, &argv, &error)) {
+		g_warning ("Can't parse %s: %s", exec, error->message);
+		g_error_free (error);
+		g_free (exec);
+		return;
+	}
+
+	if (!a11y_bus_helper_is_running (argv[0])) {
+		if (!g_spawn_async (NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+		                    NULL, NULL, NULL, &error)) {
+			g_warning ("Can't launch %s: %s", exec, error->message);
+			g_error_free (error);
+		}
+		else {
+			STATS_ADD (STATS_PROCESSES_SPAWNED, 1);
+		}
+	}
+
+	g_strfreev (argv);
+	g_free (exec);
+}
+
+void
+a11y_bus_start_helpers (gboolean screen_reader,
+                        gboolean keyboard)
+{
+	if (screen_reader)
+		a11y_bus_start_helper (A11Y_SCHEMA_VISUAL, VISUAL_SCHEMA, VISUAL_KEY);
+	if (keyboard)
+		a11y_bus_start_helper (A11Y_SCHEMA_MOBILITY, MOBILITY_SCHEMA, MOBILITY_KEY);
+}
@@ -0,0 +1,46 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef A11Y_BUS_H
+#define A11Y_BUS_H
+
+#include <gio/gio.h>
+
+/* Assistive technologies in the running session. Setting IsEnabled on the
+ * accessibility bus launcher starts the AT-SPI bus, and toolkits already
+ * running attach to it, so orca and onboard work without a new session. */
+
+#define A11Y_BUS_NAME      "org.a11y.Bus"
+#define A11Y_BUS_PATH      "/org/a11y/bus"
+#define A11Y_STATUS_IFACE  "org.a11y.Status"
+
+/* Time allowed to the bus launcher to answer, in ms. */
+#define A11Y_BUS_TIMEOUT 5000
+
+void     a11y_bus_set_enabled        (gboolean              enabled,
+                                      GCancellable         *cancellable,
+                                      GAsyncReadyCallback   callback,
+                                      gpointer              user_data);
+gboolean a11y_bus_set_enabled_finish (GAsyncResult         *result,
+                                      GError              **error);
+gboolean a11y_bus_set_enabled_sync   (gboolean              enabled,
+                                      GError              **error);
+
+void     a11y_bus_start_helpers      (gboolean              screen_reader,
+                                      gboolean              keyboard);
+
+#endif
@@ -0,0 +1,230 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "a11y-cli.h"
+#include "a11y-settings.h"
+#include "populate-cursors.h"
+#include "settings-bench.h"
+#include "stats.h"
+
+#define _(x) x
+#define N_(x) x
+
+/* Any count given to --bench-settings, even an invalid one, differs. */
+#define BENCH_UNSET G_MININT
+
+static gchar    **apply_assignments = NULL;
+static gboolean   query_options = FALSE;
+static gboolean   show_stats = FALSE;
+static gint       bench_iterations = BENCH_UNSET;
+static gboolean   build_catalog = FALSE;
+static gchar     *profile_file = NULL;
+static gchar     *output_dir = NULL;
+
+static GOptionEntry cli_entries[] = {
+	{ "apply", 0, 0, G_OPTION_ARG_STRING_ARRAY, &apply_assignments,
+	  N_("Aplicar una opción de accesibilidad sin abrir el diálogo"), N_("OPCIÓN=VALOR") },
+	{ "query", 0, 0, G_OPTION_ARG_NONE, &query_options,
+	  N_("Mostrar las opciones de accesibilidad actuales"), NULL },
+	{ "stats", 0, 0, G_OPTION_ARG_NONE, &show_stats,
+	  N_("Mostrar contadores internos al salir"), NULL },
+	{ "bench-settings", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_INT, &bench_iterations,
+	  N_("Medir la latencia de escritura de opciones"), N_("N") },
+	{ "compile-profile", 0, 0, G_OPTION_ARG_FILENAME, &profile_file,
+	  N_("Generar una base de dconf a partir de un perfil de accesibilidad"), N_("PERFIL") },
+	{ "output", 0, 0, G_OPTION_ARG_FILENAME, &output_dir,
+	  N_("Directorio site.d donde escribir el perfil compilado"), N_("DIRECTORIO") },
+	{ "build-system-cursor-catalog", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &build_catalog,
+	  N_("Generar el catálogo de cursores del sistema"), NULL },
+	{ NULL }
+};
+
+/* Only look at the arguments, the GUI parses everything else. */
+
+gboolean
+a11y_cli_wanted (int    argc,
+                 char **argv)
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (g_str_has_prefix (argv[i], "--apply") ||
+		    g_str_has_prefix (argv[i], "--bench-settings") ||
+		    g_strcmp0 (argv[i], "--build-system-cursor-catalog") == 0 ||
+		    g_str_has_prefix (argv[i], "--compile-profile") ||
+		    g_strcmp0 (argv[i], "--query") == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Writes <output>/<name> and <output>/locks/<name>, ready for dconf update. */
+
+static gboolean
+a11y_cli_compile_profile (const gchar  *filename,
+                          const gchar  *directory,
+                          GError      **error)
+{
+	GKeyFile *profile;
+	gchar *keyfile_data = NULL, *locks_data = NULL;
+	gchar *base, *name, *locks_dir, *path;
+	gboolean result = FALSE;
+
+	profile = g_key_file_new ();
+	if (!g_key_file_load_from_file (profile, filename, G_KEY_FILE_NONE, error))
+		goto out;
+
+	if (!a11y_settings_compile_profile (profile, &keyfile_data, &locks_data, error))
+		goto out;
+
+	base = g_path_get_basename (filename);
+	name = g_strndup (base, strcspn (base, "."));
+	g_free (base);
+
+	locks_dir = g_build_filename (directory, "locks", NULL);
+	g_mkdir_with_parents (locks_dir, 0755);
+
+	path = g_build_filename (directory, name, NULL);
+	result = g_file_set_contents (path, keyfile_data, -1, error);
+	g_free (path);
+
+	if (result) {
+		path = g_build_filename (locks_dir, name, NULL);
+		if (*locks_data)
+			result = g_file_set_contents (path, locks_data, -1, error);
+		else
+			g_unlink (path);
+		g_free (path);
+	}
+
+	g_free (locks_dir);
+	g_free (name);
+
+out:
+	g_free (keyfile_data);
+	g_free (locks_data);
+	g_key_file_free (profile);
+
+	return result;
+}
+
+static void
+a11y_cli_print_options (void)
+{
+	GVariant *value;
+	gchar *text;
+	guint i;
+
+	for (i = 0; i < N_A11Y_OPTIONS; i++) {
+		value = a11y_option_query (i);
+
+		if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+			text = g_variant_dup_string (value, NULL);
+		else
+			text = g_variant_print (value, FALSE);
+
+		g_print ("%s=%s\n", a11y_option_get_name (i), text);
+
+		g_free (text);
+		g_variant_unref (value);
+	}
+}
+
+int
+a11y_cli_run (int    argc,
+              char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	int status = EXIT_SUCCESS;
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context,
+		_("Opciones: high-contrast, large-print, screen-reader y keyboard (true/false),\n"
+		  "cursor-theme (nombre) y cursor-size (16-128)."));
+	g_option_context_add_main_entries (context, cli_entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (show_stats)
+		stats_enable ();
+
+	if (profile_file) {
+		if (!a11y_cli_compile_profile (profile_file, output_dir ? output_dir : ".", &error)) {
+			g_printerr ("%s: %s\n", profile_file, error->message);
+			g_error_free (error);
+			status = EXIT_FAILURE;
+		}
+		else {
+			g_print (_("Perfil compilado, ejecute «dconf update» para aplicarlo.\n"));
+		}
+		g_free (profile_file);
+		g_free (output_dir);
+		return status;
+	}
+
+	/* Run by the package trigger when icon themes change. */
+	if (build_catalog) {
+		if (!mouse_settings_themes_build_catalog (CURSOR_CATALOG_FILE, &error)) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (bench_iterations != BENCH_UNSET) {
+		if (bench_iterations < 1) {
+			g_printerr (_("--bench-settings necesita al menos una iteración\n"));
+			return EXIT_FAILURE;
+		}
+		status = settings_bench_run (bench_iterations);
+		a11y_settings_shutdown ();
+		if (show_stats)
+			stats_dump ();
+		return status;
+	}
+
+	if (apply_assignments) {
+		if (!a11y_settings_apply_assignments (apply_assignments, &error)) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			status = EXIT_FAILURE;
+		}
+	}
+
+	if (status == EXIT_SUCCESS && query_options)
+		a11y_cli_print_options ();
+
+	g_strfreev (apply_assignments);
+	a11y_settings_shutdown ();
+
+	stats_dump ();
+
+	return status;
+}
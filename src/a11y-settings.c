@@ -0,0 +1,898 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <string.h>
+
+#include "a11y-bus.h"
+#include "a11y-settings.h"
+#include "stats.h"
+#include "trace.h"
+
+/* Schemas */
+
+static const gchar *schema_ids[N_A11Y_SCHEMAS] = {
+	INTERFACE_SCHEMA,
+	MARCO_SCHEMA,
+	FONT_RENDER_SCHEMA,
+	MOUSE_SCHEMA,
+	VISUAL_SCHEMA,
+	MOBILITY_SCHEMA
+};
+
+static GSettings *schema_settings[N_A11Y_SCHEMAS] = { NULL, };
+
+static gdouble base_dpi = DPI_DEFAULT;
+
+/* Profiles are tables of keys to write. Before writing, a key is compared
+ * with a snapshot of its current value, and unchanged keys are skipped so
+ * that no dconf write nor change signal happens. */
+
+typedef enum {
+	A11Y_VALUE_SET,        /* the GVariant text in value */
+	A11Y_VALUE_RESET,      /* back to the default value */
+	A11Y_VALUE_ARGUMENT,   /* the value given to the option */
+	A11Y_VALUE_DPI_FACTOR  /* factor times the base DPI */
+} A11yValueKind;
+
+typedef struct {
+	A11ySchema     schema;
+	const gchar   *key;
+	A11yValueKind  kind;
+	const gchar   *value;
+	gdouble        factor;
+} A11yProfileEntry;
+
+typedef struct {
+	const A11yProfileEntry *entries;
+	guint                   n_entries;
+} A11yProfile;
+
+#define A11Y_PROFILE(entries) { entries, G_N_ELEMENTS (entries) }
+
+static const A11yProfileEntry high_contrast_on[] = {
+	{ A11Y_SCHEMA_INTERFACE, KEY_GTK_THEME,   A11Y_VALUE_SET, "'" HIGH_CONTRAST_THEME "'" },
+	{ A11Y_SCHEMA_INTERFACE, KEY_ICON_THEME,  A11Y_VALUE_SET, "'" HIGH_CONTRAST_ICON_THEME "'" },
+	{ A11Y_SCHEMA_MARCO,     KEY_MARCO_THEME, A11Y_VALUE_SET, "'" HIGH_CONTRAST_MARCO_THEME "'" }
+};
+
+static const A11yProfileEntry high_contrast_off[] = {
+	{ A11Y_SCHEMA_INTERFACE, KEY_GTK_THEME,   A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_INTERFACE, KEY_ICON_THEME,  A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_MARCO,     KEY_MARCO_THEME, A11Y_VALUE_RESET }
+};
+
+static const A11yProfileEntry large_print_on[] = {
+	{ A11Y_SCHEMA_FONT, KEY_FONT_DPI, A11Y_VALUE_DPI_FACTOR, NULL, DPI_FACTOR_LARGER }
+};
+
+static const A11yProfileEntry large_print_off[] = {
+	{ A11Y_SCHEMA_FONT, KEY_FONT_DPI, A11Y_VALUE_RESET }
+};
+
+static const A11yProfileEntry screen_reader[] = {
+	{ A11Y_SCHEMA_VISUAL, VISUAL_KEY,         A11Y_VALUE_SET, "'" VISUAL_EXEC "'" },
+	{ A11Y_SCHEMA_VISUAL, VISUAL_STARTUP_KEY, A11Y_VALUE_ARGUMENT }
+};
+
+static const A11yProfileEntry keyboard[] = {
+	{ A11Y_SCHEMA_MOBILITY, MOBILITY_KEY,         A11Y_VALUE_SET, "'" MOBILITY_EXEC "'" },
+	{ A11Y_SCHEMA_MOBILITY, MOBILITY_STARTUP_KEY, A11Y_VALUE_ARGUMENT }
+};
+
+static const A11yProfileEntry cursor_theme[] = {
+	{ A11Y_SCHEMA_MOUSE, KEY_CURSOR_THEME, A11Y_VALUE_ARGUMENT }
+};
+
+static const A11yProfileEntry cursor_size[] = {
+	{ A11Y_SCHEMA_MOUSE, KEY_CURSOR_SIZE, A11Y_VALUE_ARGUMENT }
+};
+
+static const A11yProfileEntry accessibility[] = {
+	{ A11Y_SCHEMA_INTERFACE, ACCESSIBILITY_KEY, A11Y_VALUE_ARGUMENT }
+};
+
+static const A11yProfileEntry at_defaults[] = {
+	{ A11Y_SCHEMA_VISUAL,   VISUAL_KEY,   A11Y_VALUE_SET, "'" VISUAL_EXEC "'" },
+	{ A11Y_SCHEMA_MOBILITY, MOBILITY_KEY, A11Y_VALUE_SET, "'" MOBILITY_EXEC "'" }
+};
+
+static const A11yProfileEntry user_changes_reset[] = {
+	{ A11Y_SCHEMA_FONT,      KEY_FONT_DPI,     A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_INTERFACE, KEY_GTK_THEME,    A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_INTERFACE, KEY_ICON_THEME,   A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_MARCO,     KEY_MARCO_THEME,  A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_MOUSE,     KEY_CURSOR_THEME, A11Y_VALUE_RESET },
+	{ A11Y_SCHEMA_MOUSE,     KEY_CURSOR_SIZE,  A11Y_VALUE_RESET }
+};
+
+/* Options write their "on" profile when given TRUE or a non boolean
+ * value, and their "off" profile when given FALSE. */
+
+static const struct {
+	const gchar *name;
+	const gchar *type;
+	A11yProfile  on;
+	A11yProfile  off;
+} options[N_A11Y_OPTIONS] = {
+	{ "high-contrast", "b", A11Y_PROFILE (high_contrast_on), A11Y_PROFILE (high_contrast_off) },
+	{ "large-print",   "b", A11Y_PROFILE (large_print_on),   A11Y_PROFILE (large_print_off) },
+	{ "screen-reader", "b", A11Y_PROFILE (screen_reader),    A11Y_PROFILE (screen_reader) },
+	{ "keyboard",      "b", A11Y_PROFILE (keyboard),         A11Y_PROFILE (keyboard) },
+	{ "cursor-theme",  "s", A11Y_PROFILE (cursor_theme),     A11Y_PROFILE (cursor_theme) },
+	{ "cursor-size",   "i", A11Y_PROFILE (cursor_size),      A11Y_PROFILE (cursor_size) }
+};
+
+enum {
+	PROFILE_ACCESSIBILITY,
+	PROFILE_AT_DEFAULTS,
+	PROFILE_USER_CHANGES_RESET,
+	N_OTHER_PROFILES
+};
+
+static const A11yProfile other_profiles[N_OTHER_PROFILES] = {
+	[PROFILE_ACCESSIBILITY]      = A11Y_PROFILE (accessibility),
+	[PROFILE_AT_DEFAULTS]        = A11Y_PROFILE (at_defaults),
+	[PROFILE_USER_CHANGES_RESET] = A11Y_PROFILE (user_changes_reset)
+};
+
+/* Snapshot of the keys used by the profiles */
+
+typedef struct {
+	GVariant *user_value;     /* NULL while the key has its default value */
+	GVariant *default_value;
+} A11ySnapshotEntry;
+
+static GHashTable *snapshot[N_A11Y_SCHEMAS] = { NULL, };
+
+static void
+a11y_snapshot_entry_free (A11ySnapshotEntry *entry)
+{
+	if (entry->user_value)
+		g_variant_unref (entry->user_value);
+	if (entry->default_value)
+		g_variant_unref (entry->default_value);
+	g_slice_free (A11ySnapshotEntry, entry);
+}
+
+static A11ySnapshotEntry *
+a11y_snapshot_read (A11ySchema   schema,
+                    const gchar *key)
+{
+	A11ySnapshotEntry *entry;
+	GSettings *settings;
+
+	settings = a11y_settings_get (schema);
+
+	entry = g_hash_table_lookup (snapshot[schema], key);
+	if (entry == NULL) {
+		entry = g_slice_new0 (A11ySnapshotEntry);
+		entry->default_value = g_settings_get_default_value (settings, key);
+		STATS_SETTINGS_READ (schema_ids[schema]);
+		g_hash_table_insert (snapshot[schema], g_strdup (key), entry);
+	}
+	else if (entry->user_value) {
+		g_variant_unref (entry->user_value);
+	}
+
+	entry->user_value = g_settings_get_user_value (settings, key);
+	STATS_SETTINGS_READ (schema_ids[schema]);
+
+	return entry;
+}
+
+static A11ySnapshotEntry *
+a11y_snapshot_lookup (A11ySchema   schema,
+                      const gchar *key)
+{
+	A11ySnapshotEntry *entry;
+
+	a11y_settings_get (schema);
+
+	entry = g_hash_table_lookup (snapshot[schema], key);
+	if (entry == NULL)
+		entry = a11y_snapshot_read (schema, key);
+
+	return entry;
+}
+
+/* Keep the snapshot in sync with writes made by anyone. */
+
+static void
+a11y_snapshot_changed (GSettings   *settings,
+                       const gchar *key,
+                       gpointer     user_data)
+{
+	A11ySchema schema = GPOINTER_TO_UINT (user_data);
+
+	if (g_hash_table_contains (snapshot[schema], key))
+		a11y_snapshot_read (schema, key);
+}
+
+GSettings *
+a11y_settings_get (A11ySchema schema)
+{
+	g_return_val_if_fail (schema < N_A11Y_SCHEMAS, NULL);
+
+	if (schema_settings[schema] == NULL) {
+		schema_settings[schema] = g_settings_new (schema_ids[schema]);
+		snapshot[schema] = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                          (GDestroyNotify) a11y_snapshot_entry_free);
+
+		g_signal_connect (schema_settings[schema], "changed",
+		                  G_CALLBACK (a11y_snapshot_changed), GUINT_TO_POINTER (schema));
+	}
+
+	return schema_settings[schema];
+}
+
+static void
+a11y_profile_snapshot (const A11yProfile *profile)
+{
+	guint i;
+
+	for (i = 0; i < profile->n_entries; i++)
+		a11y_snapshot_lookup (profile->entries[i].schema, profile->entries[i].key);
+}
+
+/* Read every key the profiles may write, once. */
+
+void
+a11y_settings_snapshot (void)
+{
+	guint i;
+
+	for (i = 0; i < N_A11Y_OPTIONS; i++) {
+		a11y_profile_snapshot (&options[i].on);
+		a11y_profile_snapshot (&options[i].off);
+	}
+
+	for (i = 0; i < N_OTHER_PROFILES; i++)
+		a11y_profile_snapshot (&other_profiles[i]);
+}
+
+/* Write the keys of the profile that differ from the snapshot. Returns
+ * the number of keys written. */
+
+static guint
+a11y_profile_apply (const A11yProfile *profile,
+                    GVariant          *argument)
+{
+	const A11yProfileEntry *entry;
+	A11ySnapshotEntry *current;
+	GSettings *settings;
+	GVariant *value;
+	guint i, writes = 0;
+	gint64 span;
+
+	for (i = 0; i < profile->n_entries; i++) {
+		entry = &profile->entries[i];
+		settings = a11y_settings_get (entry->schema);
+		current = a11y_snapshot_lookup (entry->schema, entry->key);
+
+		if (entry->kind == A11Y_VALUE_RESET) {
+			if (current->user_value != NULL) {
+				span = TRACE_BEGIN ();
+				g_settings_reset (settings, entry->key);
+				TRACE_END (span, "gsettings", "reset", entry->key);
+				STATS_SETTINGS_WRITE (schema_ids[entry->schema]);
+				writes++;
+			}
+			continue;
+		}
+
+		switch (entry->kind) {
+			case A11Y_VALUE_SET:
+				value = g_variant_parse (NULL, entry->value, NULL, NULL, NULL);
+				break;
+			case A11Y_VALUE_DPI_FACTOR:
+				value = g_variant_ref_sink (g_variant_new_double (entry->factor * base_dpi));
+				break;
+			case A11Y_VALUE_ARGUMENT:
+			default:
+				value = g_variant_ref (argument);
+				break;
+		}
+
+		if (!g_variant_equal (value, current->user_value ? current->user_value : current->default_value)) {
+			span = TRACE_BEGIN ();
+			g_settings_set_value (settings, entry->key, value);
+			TRACE_END (span, "gsettings", "write", entry->key);
+			STATS_SETTINGS_WRITE (schema_ids[entry->schema]);
+			writes++;
+		}
+
+		g_variant_unref (value);
+	}
+
+	return writes;
+}
+
+void
+a11y_settings_apply_at_defaults (void)
+{
+	a11y_profile_apply (&other_profiles[PROFILE_AT_DEFAULTS], NULL);
+}
+
+void
+a11y_settings_reset_user_changes (void)
+{
+	a11y_profile_apply (&other_profiles[PROFILE_USER_CHANGES_RESET], NULL);
+}
+
+gboolean
+a11y_settings_get_accessibility (void)
+{
+	STATS_SETTINGS_READ (INTERFACE_SCHEMA);
+
+	return g_settings_get_boolean (a11y_settings_get (A11Y_SCHEMA_INTERFACE), ACCESSIBILITY_KEY);
+}
+
+void
+a11y_settings_set_accessibility (gboolean enabled)
+{
+	GVariant *value;
+
+	value = g_variant_ref_sink (g_variant_new_boolean (enabled));
+	a11y_profile_apply (&other_profiles[PROFILE_ACCESSIBILITY], value);
+	g_variant_unref (value);
+}
+
+/* Large print is relative to this DPI. Without a display it is the
+ * default one, the dialog sets the one of the X server. */
+
+void
+a11y_settings_set_base_dpi (gdouble dpi)
+{
+	base_dpi = dpi;
+}
+
+gdouble
+a11y_settings_get_base_dpi (void)
+{
+	return base_dpi;
+}
+
+gdouble
+a11y_settings_get_large_print_factor (void)
+{
+	gdouble dpi;
+
+	dpi = g_settings_get_double (a11y_settings_get (A11Y_SCHEMA_FONT), KEY_FONT_DPI);
+	STATS_SETTINGS_READ (FONT_RENDER_SCHEMA);
+
+	return dpi > base_dpi ? dpi / base_dpi : 1.0;
+}
+
+void
+a11y_settings_set_large_print_factor (gdouble factor)
+{
+	A11yProfileEntry entry = { A11Y_SCHEMA_FONT, KEY_FONT_DPI, A11Y_VALUE_DPI_FACTOR, NULL, factor };
+	A11yProfile profile = { &entry, 1 };
+
+	/* Like the large-print option, with a factor other than the default. */
+	if (factor > 1.0)
+		a11y_profile_apply (&profile, NULL);
+	else
+		a11y_profile_apply (&options[A11Y_OPTION_LARGE_PRINT].off, NULL);
+}
+
+void
+a11y_settings_shutdown (void)
+{
+	guint i;
+
+	for (i = 0; i < N_A11Y_SCHEMAS; i++) {
+		g_clear_object (&schema_settings[i]);
+		g_clear_pointer (&snapshot[i], g_hash_table_destroy);
+	}
+}
+
+/* Options */
+
+const gchar *
+a11y_option_get_name (A11yOption option)
+{
+	g_return_val_if_fail (option < N_A11Y_OPTIONS, NULL);
+
+	return options[option].name;
+}
+
+static gboolean
+a11y_option_parse_boolean (const gchar *text,
+                           gboolean    *value)
+{
+	if (!g_ascii_strcasecmp (text, "true") ||
+	    !g_ascii_strcasecmp (text, "on") ||
+	    !g_ascii_strcasecmp (text, "yes") ||
+	    !g_strcmp0 (text, "1")) {
+		*value = TRUE;
+		return TRUE;
+	}
+	if (!g_ascii_strcasecmp (text, "false") ||
+	    !g_ascii_strcasecmp (text, "off") ||
+	    !g_ascii_strcasecmp (text, "no") ||
+	    !g_strcmp0 (text, "0")) {
+		*value = FALSE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+a11y_option_parse (const gchar *assignment,
+                   A11yOption  *option,
+                   GVariant   **value,
+                   GError     **error)
+{
+	const gchar *text;
+	gchar *name, *end = NULL;
+	gboolean boolean;
+	gint64 number;
+	guint i;
+
+	text = strchr (assignment, '=');
+	if (text == NULL) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+		             "Expected OPTION=VALUE, got “%s”", assignment);
+		return FALSE;
+	}
+
+	name = g_strndup (assignment, text - assignment);
+	text++;
+
+	for (i = 0; i < N_A11Y_OPTIONS; i++)
+		if (g_strcmp0 (name, options[i].name) == 0)
+			break;
+
+	if (i == N_A11Y_OPTIONS) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+		             "Unknown option “%s”", name);
+		g_free (name);
+		return FALSE;
+	}
+	g_free (name);
+
+	switch (options[i].type[0]) {
+		case 'b':
+			if (!a11y_option_parse_boolean (text, &boolean))
+				goto bad_value;
+			*value = g_variant_ref_sink (g_variant_new_boolean (boolean));
+			break;
+		case 'i':
+			number = g_ascii_strtoll (text, &end, 10);
+			if (end == text || *end != '\0' ||
+			    number < CURSOR_SIZE_MIN || number > CURSOR_SIZE_MAX)
+				goto bad_value;
+			*value = g_variant_ref_sink (g_variant_new_int32 (number));
+			break;
+		case 's':
+		default:
+			if (*text == '\0')
+				goto bad_value;
+			*value = g_variant_ref_sink (g_variant_new_string (text));
+			break;
+	}
+
+	*option = i;
+
+	return TRUE;
+
+bad_value:
+	g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+	             "Invalid value “%s” for %s", text, options[i].name);
+	return FALSE;
+}
+
+static gboolean
+high_contrast_is_selected (void)
+{
+	gchar *gtk_theme = NULL;
+	gboolean high_gtk_theme;
+
+	gtk_theme = g_settings_get_string (a11y_settings_get (A11Y_SCHEMA_INTERFACE), KEY_GTK_THEME);
+	STATS_SETTINGS_READ (INTERFACE_SCHEMA);
+	high_gtk_theme = (g_strcmp0(gtk_theme, HIGH_CONTRAST_THEME) == 0);
+
+	g_free (gtk_theme);
+
+	return high_gtk_theme;
+}
+
+GVariant *
+a11y_option_query (A11yOption option)
+{
+	GVariant *value = NULL;
+
+	switch (option) {
+		case A11Y_OPTION_HIGH_CONTRAST:
+			value = g_variant_new_boolean (high_contrast_is_selected ());
+			break;
+		case A11Y_OPTION_LARGE_PRINT:
+			value = g_variant_new_boolean (g_settings_get_double (a11y_settings_get (A11Y_SCHEMA_FONT), KEY_FONT_DPI) > base_dpi);
+			STATS_SETTINGS_READ (FONT_RENDER_SCHEMA);
+			break;
+		case A11Y_OPTION_SCREEN_READER:
+			value = g_settings_get_value (a11y_settings_get (A11Y_SCHEMA_VISUAL), VISUAL_STARTUP_KEY);
+			STATS_SETTINGS_READ (VISUAL_SCHEMA);
+			break;
+		case A11Y_OPTION_KEYBOARD:
+			value = g_settings_get_value (a11y_settings_get (A11Y_SCHEMA_MOBILITY), MOBILITY_STARTUP_KEY);
+			STATS_SETTINGS_READ (MOBILITY_SCHEMA);
+			break;
+		case A11Y_OPTION_CURSOR_THEME:
+			value = g_settings_get_value (a11y_settings_get (A11Y_SCHEMA_MOUSE), KEY_CURSOR_THEME);
+			STATS_SETTINGS_READ (MOUSE_SCHEMA);
+			break;
+		case A11Y_OPTION_CURSOR_SIZE:
+			value = g_settings_get_value (a11y_settings_get (A11Y_SCHEMA_MOUSE), KEY_CURSOR_SIZE);
+			STATS_SETTINGS_READ (MOUSE_SCHEMA);
+			break;
+		default:
+			g_return_val_if_reached (NULL);
+	}
+
+	return g_variant_ref_sink (value);
+}
+
+void
+a11y_option_apply (A11yOption  option,
+                   GVariant   *value)
+{
+	g_return_if_fail (option < N_A11Y_OPTIONS);
+
+	g_variant_ref_sink (value);
+
+	if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN) &&
+	    !g_variant_get_boolean (value))
+		a11y_profile_apply (&options[option].off, value);
+	else
+		a11y_profile_apply (&options[option].on, value);
+
+	g_variant_unref (value);
+}
+
+gboolean
+a11y_option_get_boolean (A11yOption option)
+{
+	GVariant *value;
+	gboolean result;
+
+	value = a11y_option_query (option);
+	result = g_variant_get_boolean (value);
+	g_variant_unref (value);
+
+	return result;
+}
+
+void
+a11y_option_set_boolean (A11yOption option,
+                         gboolean   value)
+{
+	a11y_option_apply (option, g_variant_new_boolean (value));
+}
+
+/* Apply several OPTION=VALUE assignments in a single batch. Nothing is
+ * written unless every assignment is valid. The shared settings are left
+ * in delay-apply mode, so this is meant for one-shot callers. */
+
+gboolean
+a11y_settings_apply_assignments (gchar   **assignments,
+                                 GError  **error)
+{
+	GVariant *values[N_A11Y_OPTIONS] = { NULL, };
+	A11yOption option;
+	GVariant *value;
+	gboolean screen_reader = FALSE, keyboard = FALSE;
+	gboolean need_at = FALSE, result = FALSE;
+	GError *bus_error = NULL;
+	guint i;
+
+	for (i = 0; assignments && assignments[i]; i++) {
+		if (!a11y_option_parse (assignments[i], &option, &value, error))
+			goto out;
+
+		if (values[option])
+			g_variant_unref (values[option]);
+		values[option] = value;
+	}
+
+	a11y_settings_snapshot ();
+
+	for (i = 0; i < N_A11Y_SCHEMAS; i++)
+		g_settings_delay (a11y_settings_get (i));
+
+	for (i = 0; i < N_A11Y_OPTIONS; i++)
+		if (values[i])
+			a11y_option_apply (i, values[i]);
+
+	/* Assistive technologies need the accessibility bus. */
+	if (values[A11Y_OPTION_SCREEN_READER] || values[A11Y_OPTION_KEYBOARD]) {
+		screen_reader = a11y_option_get_boolean (A11Y_OPTION_SCREEN_READER);
+		keyboard = a11y_option_get_boolean (A11Y_OPTION_KEYBOARD);
+		need_at = screen_reader || keyboard;
+		a11y_settings_set_accessibility (need_at);
+	}
+
+	for (i = 0; i < N_A11Y_SCHEMAS; i++)
+		g_settings_apply (a11y_settings_get (i));
+
+	g_settings_sync ();
+
+	/* And in the running session, without a new login. */
+	if (values[A11Y_OPTION_SCREEN_READER] || values[A11Y_OPTION_KEYBOARD]) {
+		if (!a11y_bus_set_enabled_sync (need_at, &bus_error)) {
+			g_message ("Can't reach the accessibility bus: %s", bus_error->message);
+			g_error_free (bus_error);
+		}
+		else if (need_at) {
+			a11y_bus_start_helpers (screen_reader, keyboard);
+		}
+	}
+
+	result = TRUE;
+
+out:
+	for (i = 0; i < N_A11Y_OPTIONS; i++)
+		if (values[i])
+			g_variant_unref (values[i]);
+
+	return result;
+}
+
+
+/* Profiles for lab deployment. A keyfile with the options of --apply in a
+ * [Profile] group is turned into a dconf keyfile and a locks file, checked
+ * against the installed schemas. */
+
+static gboolean
+a11y_compile_entry (GSettingsSchemaSource  *source,
+                    const A11yProfileEntry *entry,
+                    GVariant               *argument,
+                    gdouble                 factor,
+                    GKeyFile               *keyfile,
+                    GHashTable             *locks,
+                    gboolean                locked,
+                    GError                **error)
+{
+	GSettingsSchema *schema;
+	GSettingsSchemaKey *key;
+	GVariant *value = NULL;
+	const gchar *path;
+	gchar *group, *text;
+	gboolean result = FALSE;
+
+	schema = g_settings_schema_source_lookup (source, schema_ids[entry->schema], TRUE);
+	if (schema == NULL) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+		             "Schema “%s” is not installed", schema_ids[entry->schema]);
+		return FALSE;
+	}
+
+	path = g_settings_schema_get_path (schema);
+	if (path == NULL || !g_settings_schema_has_key (schema, entry->key)) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+		             "Schema “%s” has no key “%s” at a fixed path",
+		             schema_ids[entry->schema], entry->key);
+		g_settings_schema_unref (schema);
+		return FALSE;
+	}
+
+	key = g_settings_schema_get_key (schema, entry->key);
+
+	switch (entry->kind) {
+		case A11Y_VALUE_SET:
+			value = g_variant_parse (g_settings_schema_key_get_value_type (key),
+			                         entry->value, NULL, NULL, NULL);
+			break;
+		case A11Y_VALUE_DPI_FACTOR:
+			value = g_variant_ref_sink (g_variant_new_double (factor * DPI_DEFAULT));
+			break;
+		case A11Y_VALUE_ARGUMENT:
+			value = g_variant_ref (argument);
+			break;
+		case A11Y_VALUE_RESET:
+		default:
+			/* The site database simply keeps the schema default. */
+			break;
+	}
+
+	if (value &&
+	    (!g_variant_is_of_type (value, g_settings_schema_key_get_value_type (key)) ||
+	     !g_settings_schema_key_range_check (key, value))) {
+		text = g_variant_print (value, TRUE);
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+		             "Value %s is not valid for %s %s",
+		             text, schema_ids[entry->schema], entry->key);
+		g_free (text);
+		goto out;
+	}
+
+	group = g_strndup (path + 1, strlen (path) - 2);
+
+	if (value) {
+		text = g_variant_print (value, FALSE);
+		g_key_file_set_value (keyfile, group, entry->key, text);
+		g_free (text);
+	}
+
+	if (locked)
+		g_hash_table_add (locks, g_strconcat (path, entry->key, NULL));
+
+	g_free (group);
+
+	result = TRUE;
+
+out:
+	if (value)
+		g_variant_unref (value);
+	g_settings_schema_key_unref (key);
+	g_settings_schema_unref (schema);
+
+	return result;
+}
+
+static gboolean
+a11y_compile_profile (GSettingsSchemaSource  *source,
+                      const A11yProfile      *profile,
+                      GVariant               *argument,
+                      gdouble                 factor,
+                      GKeyFile               *keyfile,
+                      GHashTable             *locks,
+                      gboolean                locked,
+                      GError                **error)
+{
+	guint i;
+
+	for (i = 0; i < profile->n_entries; i++)
+		if (!a11y_compile_entry (source, &profile->entries[i], argument, factor,
+		                         keyfile, locks, locked, error))
+			return FALSE;
+
+	return TRUE;
+}
+
+gboolean
+a11y_settings_compile_profile (GKeyFile  *profile,
+                               gchar    **keyfile_data,
+                               gchar    **locks_data,
+                               GError   **error)
+{
+	GVariant *values[N_A11Y_OPTIONS] = { NULL, };
+	gboolean locked[N_A11Y_OPTIONS] = { FALSE, };
+	GSettingsSchemaSource *source;
+	GKeyFile *keyfile;
+	GHashTable *locks;
+	GVariant *value;
+	A11yOption option;
+	GString *text;
+	GList *paths, *l;
+	gchar **names, **locked_names, *assignment, *raw;
+	gboolean need_at, result = FALSE;
+	gdouble factor = DPI_FACTOR_LARGER;
+	guint i;
+
+	source = g_settings_schema_source_get_default ();
+	if (source == NULL) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+		             "No GSettings schemas are installed");
+		return FALSE;
+	}
+
+	if (!g_key_file_has_group (profile, A11Y_PROFILE_GROUP)) {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+		             "Missing the [%s] group", A11Y_PROFILE_GROUP);
+		return FALSE;
+	}
+
+	keyfile = g_key_file_new ();
+	locks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* Every key is either an option, the DPI factor or the lock list. */
+	names = g_key_file_get_keys (profile, A11Y_PROFILE_GROUP, NULL, NULL);
+	for (i = 0; names[i]; i++) {
+		if (g_strcmp0 (names[i], A11Y_PROFILE_KEY_DPI_FACTOR) == 0 ||
+		    g_strcmp0 (names[i], A11Y_PROFILE_KEY_LOCKED) == 0)
+			continue;
+
+		raw = g_key_file_get_string (profile, A11Y_PROFILE_GROUP, names[i], NULL);
+		assignment = g_strconcat (names[i], "=", raw, NULL);
+		g_free (raw);
+
+		if (!a11y_option_parse (assignment, &option, &value, error)) {
+			g_free (assignment);
+			g_strfreev (names);
+			goto out;
+		}
+		g_free (assignment);
+
+		if (values[option])
+			g_variant_unref (values[option]);
+		values[option] = value;
+	}
+	g_strfreev (names);
+
+	if (g_key_file_has_key (profile, A11Y_PROFILE_GROUP, A11Y_PROFILE_KEY_DPI_FACTOR, NULL)) {
+		factor = g_key_file_get_double (profile, A11Y_PROFILE_GROUP, A11Y_PROFILE_KEY_DPI_FACTOR, NULL);
+		if (factor < 1.0 || factor > DPI_FACTOR_LARGEST) {
+			g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+			             "%s must be between 1 and %g", A11Y_PROFILE_KEY_DPI_FACTOR,
+			             DPI_FACTOR_LARGEST);
+			goto out;
+		}
+	}
+
+	locked_names = g_key_file_get_string_list (profile, A11Y_PROFILE_GROUP, A11Y_PROFILE_KEY_LOCKED, NULL, NULL);
+	for (i = 0; locked_names && locked_names[i]; i++) {
+		for (option = 0; option < N_A11Y_OPTIONS; option++)
+			if (g_strcmp0 (locked_names[i], options[option].name) == 0)
+				break;
+
+		if (option == N_A11Y_OPTIONS || values[option] == NULL) {
+			g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+			             "Can't lock “%s”, the profile doesn't set it", locked_names[i]);
+			g_strfreev (locked_names);
+			goto out;
+		}
+		locked[option] = TRUE;
+	}
+	g_strfreev (locked_names);
+
+	for (i = 0; i < N_A11Y_OPTIONS; i++) {
+		if (values[i] == NULL)
+			continue;
+
+		if (!a11y_compile_profile (source,
+		                           g_variant_is_of_type (values[i], G_VARIANT_TYPE_BOOLEAN) &&
+		                           !g_variant_get_boolean (values[i]) ?
+		                           &options[i].off : &options[i].on,
+		                           values[i], factor, keyfile, locks, locked[i], error))
+			goto out;
+	}
+
+	/* Assistive technologies need the accessibility bus. */
+	if (values[A11Y_OPTION_SCREEN_READER] || values[A11Y_OPTION_KEYBOARD]) {
+		need_at = (values[A11Y_OPTION_SCREEN_READER] && g_variant_get_boolean (values[A11Y_OPTION_SCREEN_READER])) ||
+		          (values[A11Y_OPTION_KEYBOARD] && g_variant_get_boolean (values[A11Y_OPTION_KEYBOARD]));
+		value = g_variant_ref_sink (g_variant_new_boolean (need_at));
+		result = a11y_compile_profile (source, &other_profiles[PROFILE_ACCESSIBILITY], value, factor,
+		                               keyfile, locks, FALSE, error);
+		g_variant_unref (value);
+		if (!result)
+			goto out;
+	}
+
+	/* Sorted, so that recompiling an unchanged profile gives the same file. */
+	paths = g_list_sort (g_hash_table_get_keys (locks), (GCompareFunc) g_strcmp0);
+	text = g_string_new (NULL);
+	for (l = paths; l; l = l->next)
+		g_string_append_printf (text, "%s\n", (const gchar *) l->data);
+	g_list_free (paths);
+
+	*keyfile_data = g_key_file_to_data (keyfile, NULL, NULL);
+	*locks_data = g_string_free (text, FALSE);
+
+	result = TRUE;
+
+out:
+	for (i = 0; i < N_A11Y_OPTIONS; i++)
+		if (values[i])
+			g_variant_unref (values[i]);
+	g_hash_table_destroy (locks);
+	g_key_file_free (keyfile);
+
+	return result;
+}
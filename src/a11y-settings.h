@@ -0,0 +1,139 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef A11Y_SETTINGS_H
+#define A11Y_SETTINGS_H
+
+#include <gio/gio.h>
+
+/* Font rendering */
+
+#define DPI_FACTOR_LARGE   1.25
+#define DPI_FACTOR_LARGER  1.5
+#define DPI_FACTOR_LARGEST 2.0
+#define DPI_DEFAULT        96
+
+#define FONT_RENDER_SCHEMA "org.mate.font-rendering"
+#define KEY_FONT_DPI       "dpi"
+
+/* Default accesibility settings */
+
+#define MOBILITY_SCHEMA       "org.mate.applications-at-mobility"
+#define MOBILITY_KEY          "exec"
+#define MOBILITY_STARTUP_KEY  "startup"
+#define MOBILITY_EXEC         "onboard"
+
+#define VISUAL_SCHEMA         "org.mate.applications-at-visual"
+#define VISUAL_KEY            "exec"
+#define VISUAL_STARTUP_KEY    "startup"
+#define VISUAL_EXEC           "orca"
+
+/* Mouse settings */
+
+#define MOUSE_SCHEMA     "org.mate.peripherals-mouse"
+#define KEY_CURSOR_THEME "cursor-theme"
+#define KEY_CURSOR_SIZE  "cursor-size"
+
+#define CURSOR_SIZE_MIN  16
+#define CURSOR_SIZE_MAX  128
+
+/* Interface settings */
+
+#define INTERFACE_SCHEMA "org.mate.interface"
+#define KEY_GTK_THEME    "gtk-theme"
+#define KEY_COLOR_SCHEME "gtk-color-scheme"
+#define KEY_ICON_THEME   "icon-theme"
+
+#define ACCESSIBILITY_KEY       "accessibility"
+#define ACCESSIBILITY_SCHEMA    INTERFACE_SCHEMA
+
+#define MARCO_SCHEMA     "org.mate.Marco.general"
+#define KEY_MARCO_THEME  "theme"
+
+#define HIGH_CONTRAST_THEME  "HighContrast"
+#define HIGH_CONTRAST_ICON_THEME "huayra-accesible"
+#define HIGH_CONTRAST_MARCO_THEME "HuayraAccesible"
+
+/* Schemas shared by the dialog and the command line */
+
+typedef enum {
+	A11Y_SCHEMA_INTERFACE,
+	A11Y_SCHEMA_MARCO,
+	A11Y_SCHEMA_FONT,
+	A11Y_SCHEMA_MOUSE,
+	A11Y_SCHEMA_VISUAL,
+	A11Y_SCHEMA_MOBILITY,
+	N_A11Y_SCHEMAS
+} A11ySchema;
+
+GSettings   *a11y_settings_get          (A11ySchema schema);
+void         a11y_settings_set_base_dpi (gdouble    dpi);
+gdouble      a11y_settings_get_base_dpi (void);
+void         a11y_settings_shutdown     (void);
+
+void         a11y_settings_snapshot           (void);
+void         a11y_settings_apply_at_defaults  (void);
+void         a11y_settings_reset_user_changes (void);
+gboolean     a11y_settings_get_accessibility  (void);
+void         a11y_settings_set_accessibility  (gboolean enabled);
+
+/* Large print as a factor of the base DPI, 1.0 when it is off. */
+gdouble      a11y_settings_get_large_print_factor (void);
+void         a11y_settings_set_large_print_factor (gdouble factor);
+
+/* Accessibility options, as the user sees them */
+
+typedef enum {
+	A11Y_OPTION_HIGH_CONTRAST,
+	A11Y_OPTION_LARGE_PRINT,
+	A11Y_OPTION_SCREEN_READER,
+	A11Y_OPTION_KEYBOARD,
+	A11Y_OPTION_CURSOR_THEME,
+	A11Y_OPTION_CURSOR_SIZE,
+	N_A11Y_OPTIONS
+} A11yOption;
+
+const gchar *a11y_option_get_name    (A11yOption   option);
+gboolean     a11y_option_parse       (const gchar *assignment,
+                                      A11yOption  *option,
+                                      GVariant   **value,
+                                      GError     **error);
+
+GVariant    *a11y_option_query       (A11yOption   option);
+void         a11y_option_apply       (A11yOption   option,
+                                      GVariant    *value);
+
+gboolean     a11y_option_get_boolean (A11yOption   option);
+void         a11y_option_set_boolean (A11yOption   option,
+                                      gboolean     value);
+
+gboolean     a11y_settings_apply_assignments (gchar   **assignments,
+                                              GError  **error);
+
+/* Deployment profiles: the options as keys of a [Profile] group, plus an
+ * optional DPI factor for large print and a list of options to lock. */
+
+#define A11Y_PROFILE_GROUP          "Profile"
+#define A11Y_PROFILE_KEY_DPI_FACTOR "large-print-factor"
+#define A11Y_PROFILE_KEY_LOCKED     "locked"
+
+gboolean     a11y_settings_compile_profile (GKeyFile  *profile,
+                                            gchar    **keyfile_data,
+                                            gchar    **locks_data,
+                                            GError   **error);
+
+#endif /* A11Y_SETTINGS_H */
@@ -0,0 +1,280 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "alloc-accounting.h"
+
+#ifdef ENABLE_ALLOC_ACCOUNTING
+
+#include <malloc.h>
+
+/* A handler that grows the heap this many times in a row is a leak. */
+#define LEAK_STREAK 8
+
+typedef struct {
+	const gchar *name;
+	guint        calls;
+	gint64       net_bytes;
+	gint64       net_objects;
+	guint        skipped;
+	guint        streak;
+	gboolean     reported;
+} AccountedHandler;
+
+typedef struct {
+	gsize bytes;
+	gsize cached;
+	guint objects;
+	gint  epoch;
+} AllocSample;
+
+static GHashTable *handlers = NULL;
+static GArray *samples = NULL;
+static GPtrArray *caches = NULL;
+
+/* Bumped by every worker and D-Bus message; a sample is only trusted if
+ * it did not move while the handler ran, no worker was busy and no cache
+ * changed its size. */
+static volatile gint worker_epoch = 0;
+static volatile gint workers_busy = 0;
+
+static gsize
+alloc_bytes_in_use (void)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 info = mallinfo2 ();
+
+	return info.uordblks + info.hblkhd;
+#else
+	struct mallinfo info = mallinfo ();
+
+	return (gsize) info.uordblks + (gsize) info.hblkhd;
+#endif
+}
+
+static gsize
+alloc_bytes_cached (void)
+{
+	AllocAccountingCacheFunc func;
+	gsize bytes = 0;
+	guint i;
+
+	for (i = 0; caches != NULL && i < caches->len; i++) {
+		func = (AllocAccountingCacheFunc) g_ptr_array_index (caches, i);
+		bytes += func ();
+	}
+
+	return bytes;
+}
+
+static guint
+alloc_count_instances (GType type)
+{
+	GType *children;
+	guint i, n_children, count;
+
+	count = g_type_get_instance_count (type);
+
+	children = g_type_children (type, &n_children);
+	for (i = 0; i < n_children; i++)
+		count += alloc_count_instances (children[i]);
+	g_free (children);
+
+	return count;
+}
+
+static void
+alloc_accounting_pre (gpointer  data,
+                      GClosure *closure)
+{
+	AllocSample sample;
+
+	/* Count first, so its temporary allocations are already freed. */
+	sample.objects = alloc_count_instances (G_TYPE_OBJECT);
+	sample.epoch = g_atomic_int_get (&worker_epoch);
+	sample.cached = alloc_bytes_cached ();
+	sample.bytes = alloc_bytes_in_use ();
+
+	g_array_append_val (samples, sample);
+}
+
+static void
+alloc_accounting_post (gpointer  data,
+                       GClosure *closure)
+{
+	AccountedHandler *handler = data;
+	AllocSample *sample;
+	gint64 bytes, objects;
+	gboolean settled;
+
+	bytes = alloc_bytes_in_use ();
+	objects = alloc_count_instances (G_TYPE_OBJECT);
+
+	/* Nested emissions are included in the outer handler. */
+	sample = &g_array_index (samples, AllocSample, samples->len - 1);
+	bytes -= sample->bytes;
+	objects -= sample->objects;
+
+	/* Caches may grow up to their budget, that is not a leak. */
+	settled = g_atomic_int_get (&workers_busy) == 0 &&
+	          g_atomic_int_get (&worker_epoch) == sample->epoch &&
+	          alloc_bytes_cached () == sample->cached;
+	g_array_set_size (samples, samples->len - 1);
+
+	handler->calls++;
+
+	/* Other threads shared the heap meanwhile, don't guess. */
+	if (!settled) {
+		handler->skipped++;
+		return;
+	}
+
+	handler->net_bytes += bytes;
+	handler->net_objects += objects;
+
+	if (bytes > 0 || objects > 0)
+		handler->streak++;
+	else
+		handler->streak = 0;
+
+	if (handler->streak >= LEAK_STREAK && !handler->reported) {
+		g_critical ("%s leaked in %u calls in a row: %" G_GINT64_FORMAT " bytes, %"
+		            G_GINT64_FORMAT " objects since startup",
+		            handler->name, handler->streak,
+		            handler->net_bytes, handler->net_objects);
+		handler->reported = TRUE;
+	}
+}
+
+static GDBusMessage *
+alloc_accounting_bus_filter (GDBusConnection *connection,
+                             GDBusMessage    *message,
+                             gboolean         incoming,
+                             gpointer         user_data)
+{
+	/* The GDBus worker thread allocates for every message. */
+	g_atomic_int_inc (&worker_epoch);
+
+	return message;
+}
+
+static void
+alloc_accounting_bus_ready (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	GDBusConnection *connection;
+
+	connection = g_bus_get_finish (result, NULL);
+	if (connection == NULL)
+		return;
+
+	/* Kept for the life of the process, like the shared connection. */
+	g_dbus_connection_add_filter (connection, alloc_accounting_bus_filter,
+	                              NULL, NULL);
+}
+
+void
+alloc_accounting_watch_bus (GBusType bus_type)
+{
+	g_bus_get (bus_type, NULL, alloc_accounting_bus_ready, NULL);
+}
+
+void
+alloc_accounting_add_cache (AllocAccountingCacheFunc func)
+{
+	if (caches == NULL)
+		caches = g_ptr_array_new ();
+
+	g_ptr_array_add (caches, (gpointer) func);
+}
+
+void
+alloc_accounting_worker_begin (void)
+{
+	g_atomic_int_inc (&workers_busy);
+	g_atomic_int_inc (&worker_epoch);
+}
+
+void
+alloc_accounting_worker_end (void)
+{
+	g_atomic_int_inc (&worker_epoch);
+	g_atomic_int_add (&workers_busy, -1);
+}
+
+gulong
+alloc_accounting_connect (gpointer     instance,
+                          const gchar *detailed_signal,
+                          GCallback    callback,
+                          gpointer     data,
+                          GObject     *gobject,
+                          const gchar *name)
+{
+	AccountedHandler *handler;
+	GClosure *closure;
+
+	if (handlers == NULL) {
+		handlers = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+		samples = g_array_new (FALSE, FALSE, sizeof (AllocSample));
+	}
+
+	/* Handlers connected more than once share their totals. */
+	handler = g_hash_table_lookup (handlers, name);
+	if (handler == NULL) {
+		handler = g_new0 (AccountedHandler, 1);
+		handler->name = name;
+		g_hash_table_insert (handlers, (gpointer) name, handler);
+	}
+
+	if (gobject)
+		closure = g_cclosure_new_object (callback, gobject);
+	else
+		closure = g_cclosure_new (callback, data, NULL);
+
+	g_closure_add_marshal_guards (closure,
+	                              handler, alloc_accounting_pre,
+	                              handler, alloc_accounting_post);
+
+	return g_signal_connect_closure (instance, detailed_signal, closure, FALSE);
+}
+
+void
+alloc_accounting_report (void)
+{
+	GHashTableIter iter;
+	AccountedHandler *handler;
+
+	if (handlers == NULL)
+		return;
+
+	g_printerr ("%-40s %8s %8s %12s %8s\n", "handler", "calls", "skipped", "bytes", "objects");
+
+	g_hash_table_iter_init (&iter, handlers);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &handler)) {
+		if (handler->calls == 0)
+			continue;
+		g_printerr ("%-40s %8u %8u %+12" G_GINT64_FORMAT " %+8" G_GINT64_FORMAT "\n",
+		            handler->name, handler->calls, handler->skipped,
+		            handler->net_bytes, handler->net_objects);
+	}
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef ALLOC_ACCOUNTING_H
+#define ALLOC_ACCOUNTING_H
+
+#include <gio/gio.h>
+
+/* Debug builds configured with --enable-alloc-accounting measure the heap
+ * bytes and GObject instances that each UI signal handler leaves behind.
+ * Instance counts need GOBJECT_DEBUG=instance-count in the environment.
+ * Other builds connect the handlers as usual.
+ *
+ * The heap counters are process-wide, so a handler is only measured while
+ * no worker thread and no D-Bus traffic ran during its emission. Workers
+ * mark their bodies with alloc_accounting_worker_begin() and _end(), the
+ * watched buses count their messages, and a sample is dropped when one of
+ * the bounded caches changed its size. */
+
+#ifdef ENABLE_ALLOC_ACCOUNTING
+
+#define ACCOUNTED_SIGNAL_CONNECT(instance, signal, handler, data)           \
+	alloc_accounting_connect (instance, signal, G_CALLBACK (handler),   \
+	                          data, NULL, #handler)
+
+#define ACCOUNTED_SIGNAL_CONNECT_OBJECT(instance, signal, handler, gobject) \
+	alloc_accounting_connect (instance, signal, G_CALLBACK (handler),   \
+	                          NULL, G_OBJECT (gobject), #handler)
+
+gulong alloc_accounting_connect (gpointer     instance,
+                                 const gchar *detailed_signal,
+                                 GCallback    handler,
+                                 gpointer     data,
+                                 GObject     *gobject,
+                                 const gchar *name);
+void   alloc_accounting_report  (void);
+
+typedef gsize (*AllocAccountingCacheFunc) (void);
+
+void   alloc_accounting_watch_bus    (GBusType                 bus_type);
+void   alloc_accounting_add_cache    (AllocAccountingCacheFunc func);
+void   alloc_accounting_worker_begin (void);
+void   alloc_accounting_worker_end   (void);
+
+#else
+
+#define ACCOUNTED_SIGNAL_CONNECT(instance, signal, handler, data)           \
+	g_signal_connect (instance, signal, G_CALLBACK (handler), data)
+
+#define ACCOUNTED_SIGNAL_CONNECT_OBJECT(instance, signal, handler, gobject) \
+	g_signal_connect_object (instance, signal, G_CALLBACK (handler), gobject, 0)
+
+#define alloc_accounting_report() G_STMT_START { } G_STMT_END
+#define alloc_accounting_watch_bus(bus_type) G_STMT_START { } G_STMT_END
+#define alloc_accounting_add_cache(func) G_STMT_START { } G_STMT_END
+#define alloc_accounting_worker_begin() G_STMT_START { } G_STMT_END
+#define alloc_accounting_worker_end() G_STMT_START { } G_STMT_END
+
+#endif
+
+#endif
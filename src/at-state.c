@@ -0,0 +1,206 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include "a11y-bus.h"
+#include "a11y-settings.h"
+#include "at-state.h"
+#include "stats.h"
+
+static const struct {
+	A11ySchema    schema;
+	const gchar  *schema_id;
+	const gchar  *key;
+	AtStateField  field;
+} settings_fields[] = {
+	{ A11Y_SCHEMA_INTERFACE, INTERFACE_SCHEMA, ACCESSIBILITY_KEY,    AT_STATE_ACCESSIBILITY },
+	{ A11Y_SCHEMA_VISUAL,    VISUAL_SCHEMA,    VISUAL_STARTUP_KEY,   AT_STATE_SCREEN_READER },
+	{ A11Y_SCHEMA_MOBILITY,  MOBILITY_SCHEMA,  MOBILITY_STARTUP_KEY, AT_STATE_KEYBOARD }
+};
+
+static const struct {
+	const gchar  *name;
+	AtStateField  field;
+} bus_fields[] = {
+	{ "IsEnabled",           AT_STATE_BUS_ENABLED },
+	{ "ScreenReaderEnabled", AT_STATE_SCREEN_READER_ENABLED }
+};
+
+static gboolean values[N_AT_STATE_FIELDS] = { FALSE, };
+static gulong settings_handlers[G_N_ELEMENTS (settings_fields)] = { 0, };
+
+static GDBusProxy *status_proxy = NULL;
+static GCancellable *cancellable = NULL;
+
+static AtStateChangedFunc changed_func = NULL;
+static gpointer changed_data = NULL;
+
+static void
+at_state_set (AtStateField field,
+              gboolean     value)
+{
+	if (values[field] == value)
+		return;
+
+	values[field] = value;
+	if (changed_func)
+		changed_func (field, value, changed_data);
+}
+
+static void
+at_state_settings_changed (GSettings   *settings,
+                           const gchar *key,
+                           gpointer     user_data)
+{
+	guint i = GPOINTER_TO_UINT (user_data);
+
+	at_state_set (settings_fields[i].field, g_settings_get_boolean (settings, key));
+	STATS_SETTINGS_READ (settings_fields[i].schema_id);
+}
+
+static void
+at_state_bus_update (void)
+{
+	GVariant *value;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (bus_fields); i++) {
+		value = g_dbus_proxy_get_cached_property (status_proxy, bus_fields[i].name);
+		at_state_set (bus_fields[i].field,
+		              value && g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN) ?
+		              g_variant_get_boolean (value) : FALSE);
+		if (value)
+			g_variant_unref (value);
+	}
+}
+
+static void
+at_state_bus_changed (GDBusProxy *proxy,
+                      GVariant   *changed,
+                      GStrv       invalidated,
+                      gpointer    user_data)
+{
+	at_state_bus_update ();
+}
+
+static void
+at_state_owner_changed (GObject    *proxy,
+                        GParamSpec *pspec,
+                        gpointer    user_data)
+{
+	/* The launcher went away or came back. */
+	at_state_bus_update ();
+}
+
+static void
+at_state_proxy_ready (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	GError *error = NULL;
+
+	status_proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+	if (status_proxy == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_message ("Can't watch the accessibility bus: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	g_signal_connect (status_proxy, "g-properties-changed",
+	                  G_CALLBACK (at_state_bus_changed), NULL);
+	g_signal_connect (status_proxy, "notify::g-name-owner",
+	                  G_CALLBACK (at_state_owner_changed), NULL);
+
+	at_state_bus_update ();
+}
+
+void
+at_state_init (AtStateChangedFunc func,
+               gpointer           user_data)
+{
+	GSettings *settings;
+	gchar *signal;
+	guint i;
+
+	g_return_if_fail (cancellable == NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (settings_fields); i++) {
+		settings = a11y_settings_get (settings_fields[i].schema);
+		values[settings_fields[i].field] = g_settings_get_boolean (settings, settings_fields[i].key);
+		STATS_SETTINGS_READ (settings_fields[i].schema_id);
+
+		signal = g_strconcat ("changed::", settings_fields[i].key, NULL);
+		settings_handlers[i] = g_signal_connect (settings, signal,
+		                                         G_CALLBACK (at_state_settings_changed),
+		                                         GUINT_TO_POINTER (i));
+		g_free (signal);
+	}
+
+	/* Only watch the launcher, reading the state must not start it. The
+	 * proxy keeps the properties cached from PropertiesChanged. */
+	cancellable = g_cancellable_new ();
+	g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+	                          G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+	                          NULL,
+	                          A11Y_BUS_NAME,
+	                          A11Y_BUS_PATH,
+	                          A11Y_STATUS_IFACE,
+	                          cancellable,
+	                          at_state_proxy_ready,
+	                          NULL);
+
+	/* Callers read the initial values, only changes are notified. */
+	changed_func = func;
+	changed_data = user_data;
+}
+
+void
+at_state_shutdown (void)
+{
+	guint i;
+
+	if (cancellable == NULL)
+		return;
+
+	g_cancellable_cancel (cancellable);
+	g_clear_object (&cancellable);
+
+	for (i = 0; i < G_N_ELEMENTS (settings_fields); i++) {
+		if (settings_handlers[i]) {
+			g_signal_handler_disconnect (a11y_settings_get (settings_fields[i].schema),
+			                             settings_handlers[i]);
+			settings_handlers[i] = 0;
+		}
+	}
+
+	if (status_proxy) {
+		g_signal_handlers_disconnect_by_func (status_proxy, at_state_bus_changed, NULL);
+		g_signal_handlers_disconnect_by_func (status_proxy, at_state_owner_changed, NULL);
+		g_clear_object (&status_proxy);
+	}
+
+	changed_func = NULL;
+	changed_data = NULL;
+}
+
+gboolean
+at_state_get (AtStateField field)
+{
+	g_return_val_if_fail (field < N_AT_STATE_FIELDS, FALSE);
+
+	return values[field];
+}
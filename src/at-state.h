@@ -0,0 +1,47 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef AT_STATE_H
+#define AT_STATE_H
+
+#include <gio/gio.h>
+
+/* What the session knows about assistive technologies, read once and kept
+ * current from change signals, so the dialog never asks the bus or
+ * dconf again. The org.a11y.Status properties stay FALSE while the bus
+ * launcher is not running. */
+
+typedef enum {
+	AT_STATE_ACCESSIBILITY,          /* org.mate.interface accessibility */
+	AT_STATE_SCREEN_READER,          /* the screen reader starts with the session */
+	AT_STATE_KEYBOARD,               /* the keyboard starts with the session */
+	AT_STATE_BUS_ENABLED,            /* org.a11y.Status IsEnabled */
+	AT_STATE_SCREEN_READER_ENABLED,  /* org.a11y.Status ScreenReaderEnabled */
+	N_AT_STATE_FIELDS
+} AtStateField;
+
+typedef void (*AtStateChangedFunc) (AtStateField field,
+                                    gboolean     value,
+                                    gpointer     user_data);
+
+void     at_state_init     (AtStateChangedFunc  func,
+                            gpointer            user_data);
+void     at_state_shutdown (void);
+
+gboolean at_state_get      (AtStateField        field);
+
+#endif
@@ -0,0 +1,180 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "icon-cache.h"
+#include "stats.h"
+#include "trace.h"
+
+static gboolean
+icon_cache_mtime (const gchar *path,
+                  time_t      *mtime)
+{
+	GStatBuf st;
+
+	if (g_stat (path, &st) != 0)
+		return FALSE;
+
+	*mtime = st.st_mtime;
+	return TRUE;
+}
+
+gchar *
+icon_cache_find_theme (const gchar *theme)
+{
+	const gchar * const *dirs;
+	gchar *path, *index;
+	guint i, n;
+
+	/* Same lookup order as GtkIconTheme. */
+	dirs = g_get_system_data_dirs ();
+	n = g_strv_length ((gchar **) dirs);
+
+	for (i = 0; i < n + 2; i++) {
+		if (i == 0)
+			path = g_build_filename (g_get_user_data_dir (), "icons", theme, NULL);
+		else if (i == 1)
+			path = g_build_filename (g_get_home_dir (), ".icons", theme, NULL);
+		else
+			path = g_build_filename (dirs[i - 2], "icons", theme, NULL);
+
+		index = g_build_filename (path, "index.theme", NULL);
+		STATS_ADD (STATS_FILES_SCANNED, 1);
+		if (g_file_test (index, G_FILE_TEST_IS_REGULAR)) {
+			g_free (index);
+			return path;
+		}
+
+		g_free (index);
+		g_free (path);
+	}
+
+	return NULL;
+}
+
+gboolean
+icon_cache_is_fresh (const gchar *theme_dir)
+{
+	GKeyFile *index;
+	gchar *filename, **subdirs;
+	time_t cache_mtime, mtime;
+	gboolean fresh = TRUE;
+	guint i;
+
+	filename = g_build_filename (theme_dir, "icon-theme.cache", NULL);
+	if (!icon_cache_mtime (filename, &cache_mtime)) {
+		g_free (filename);
+		return FALSE;
+	}
+	g_free (filename);
+
+	/* GTK discards a cache older than the theme directory, icons added
+	 * below it only touch their own subdirectory so look there too. */
+	if (icon_cache_mtime (theme_dir, &mtime) && mtime > cache_mtime)
+		return FALSE;
+
+	index = g_key_file_new ();
+	filename = g_build_filename (theme_dir, "index.theme", NULL);
+	if (g_key_file_load_from_file (index, filename, G_KEY_FILE_NONE, NULL)) {
+		subdirs = g_key_file_get_string_list (index, "Icon Theme", "Directories", NULL, NULL);
+		for (i = 0; fresh && subdirs && subdirs[i]; i++) {
+			gchar *path = g_build_filename (theme_dir, subdirs[i], NULL);
+			if (icon_cache_mtime (path, &mtime) && mtime > cache_mtime)
+				fresh = FALSE;
+			g_free (path);
+		}
+		g_strfreev (subdirs);
+	}
+	g_free (filename);
+	g_key_file_free (index);
+
+	return fresh;
+}
+
+gboolean
+icon_cache_can_update (const gchar *theme_dir)
+{
+	gchar *tool;
+	gboolean result;
+
+	tool = g_find_program_in_path (ICON_CACHE_UPDATE_TOOL);
+	result = (tool != NULL && access (theme_dir, W_OK) == 0);
+	g_free (tool);
+
+	return result;
+}
+
+static void
+icon_cache_update_done (GObject      *source,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+	GTask *task = user_data;
+	gint64 *span = g_task_get_task_data (task);
+	GError *error = NULL;
+
+	TRACE_END (*span, "icons", "update cache", NULL);
+
+	if (!g_subprocess_wait_check_finish (G_SUBPROCESS (source), result, &error))
+		g_task_return_error (task, error);
+	else
+		g_task_return_boolean (task, TRUE);
+
+	g_object_unref (task);
+}
+
+void
+icon_cache_update_async (const gchar         *theme_dir,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+	GSubprocess *process;
+	GTask *task;
+	gint64 *span;
+	GError *error = NULL;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+
+	span = g_new (gint64, 1);
+	*span = TRACE_BEGIN ();
+	g_task_set_task_data (task, span, g_free);
+
+	/* Runs out of process, the dialog stays responsive meanwhile. */
+	process = g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_SILENCE, &error,
+	                            ICON_CACHE_UPDATE_TOOL, "--quiet", "--force",
+	                            theme_dir, NULL);
+	if (process == NULL) {
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+
+	STATS_ADD (STATS_PROCESSES_SPAWNED, 1);
+
+	g_subprocess_wait_check_async (process, cancellable, icon_cache_update_done, task);
+	g_object_unref (process);
+}
+
+gboolean
+icon_cache_update_finish (GAsyncResult  *result,
+                          GError       **error)
+{
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -0,0 +1,40 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef ICON_CACHE_H
+#define ICON_CACHE_H
+
+#include <gio/gio.h>
+
+/* Switching to an icon theme without a valid icon-theme.cache makes every
+ * running GTK application scan the whole theme tree at once. These helpers
+ * check the cache of a theme and rebuild it out of process when possible. */
+
+#define ICON_CACHE_UPDATE_TOOL "gtk-update-icon-cache"
+
+gchar    *icon_cache_find_theme    (const gchar          *theme);
+gboolean  icon_cache_is_fresh      (const gchar          *theme_dir);
+gboolean  icon_cache_can_update    (const gchar          *theme_dir);
+
+void      icon_cache_update_async  (const gchar          *theme_dir,
+                                    GCancellable         *cancellable,
+                                    GAsyncReadyCallback   callback,
+                                    gpointer              user_data);
+gboolean  icon_cache_update_finish (GAsyncResult         *result,
+                                    GError              **error);
+
+#endif
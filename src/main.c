@@ -16,10 +16,24 @@
 /*************************************************************************/
 
 #include <gtk/gtk.h>
-
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "a11y-actions.h"
+#include "a11y-bus.h"
+#include "a11y-cli.h"
+#include "a11y-settings.h"
+#include "alloc-accounting.h"
+#include "at-state.h"
 #include "huayra-hig.h"
+#include "icon-cache.h"
 #include "mate-session.h"
 #include "populate-cursors.h"
+#include "preview-cache.h"
+#include "stats.h"
+#include "trace.h"
+#include "wiki-probe.h"
 
 /* Definitions */
 
@@ -28,67 +42,54 @@
 #define DPI_LOW_REASONABLE_VALUE 50
 #define DPI_HIGH_REASONABLE_VALUE 500
 
-#define DPI_FACTOR_LARGE   1.25
-#define DPI_FACTOR_LARGER  1.5
-#define DPI_FACTOR_LARGEST 2.0
-#define DPI_DEFAULT        96
+/* When D-Bus activated, leave after this many ms without requests. */
+#define SERVICE_INACTIVITY_TIMEOUT 10000
 
-/* Default accesibility settings */
+/* Every cursor-size write reloads cursors in all X clients, so writes are
+ * held back while the user drags the scale. */
+#define CURSOR_SIZE_COMMIT_DELAY 400
 
-#define MOBILITY_SCHEMA       "org.mate.applications-at-mobility"
-#define MOBILITY_KEY          "exec"
-#define MOBILITY_STARTUP_KEY  "startup"
+/* At most this long, in ms, the cursor files are read ahead before the new
+ * theme is written and every X client loads it at once. */
+#define CURSOR_THEME_WARM_DEADLINE 300
 
-#define VISUAL_SCHEMA         "org.mate.applications-at-visual"
-#define VISUAL_KEY            "exec"
-#define VISUAL_STARTUP_KEY    "startup"
+/* Time given to the dialog to settle before measuring its memory. */
+#define STARTUP_BENCH_SETTLE 1000
 
-/* Mouse settings */
+/* Settings, shared with the command line */
 
 static GSettings *mouse_settings = NULL;
-
-#define MOUSE_SCHEMA     "org.mate.peripherals-mouse"
-#define KEY_CURSOR_THEME "cursor-theme"
-#define KEY_CURSOR_SIZE  "cursor-size"
-
-/* Interface settings */
-
 static GSettings *interface_settings = NULL;
-
-#define INTERFACE_SCHEMA "org.mate.interface"
-#define KEY_GTK_THEME    "gtk-theme"
-#define KEY_COLOR_SCHEME "gtk-color-scheme"
-#define KEY_ICON_THEME   "icon-theme"
-
 static GSettings *marco_settings = NULL;
-
-#define MARCO_SCHEMA     "org.mate.Marco.general"
-#define KEY_MARCO_THEME  "theme"
-
-#define HIGH_CONTRAST_THEME  "HighContrast"
-#define HIGH_CONTRAST_ICON_THEME "huayra-accesible"
-#define HIGH_CONTRAST_MARCO_THEME "HuayraAccesible"
-
 static GSettings *font_settings = NULL;
 
-#define FONT_RENDER_SCHEMA "org.mate.font-rendering"
-#define KEY_FONT_DPI       "dpi"
-
 /* Widgets */
 
 static GtkWidget *window = NULL;
 
 static GtkWidget *high_contrast_w = NULL;
+static GtkWidget *high_contrast_spinner_w = NULL;
 static GtkWidget *high_dpi_w = NULL;
+static GtkWidget *large_print_factor_w = NULL;
+static GtkWidget *visual_preview_w = NULL;
 static GtkWidget *mouse_theme_w = NULL;
+static GtkWidget *cursor_size_w = NULL;
+static GtkWidget *cursor_preview_w = NULL;
+static GtkWidget *cursor_busy_preview_w = NULL;
+static GtkWidget *theme_preview_w = NULL;
 
 static GtkWidget *on_screen_keyboard_w;
 static GtkWidget *speacher_w;
 
 /* Global vars */
 
-static gboolean current_on_screen_keyboard = FALSE;
-static gboolean current_speacher = FALSE;
+static gboolean at_state_loaded = FALSE;
+
+static GArray *cursor_sizes = NULL;
+static guint cursor_size_commit_id = 0;
+static gchar *cursor_theme_pending = NULL;
+static GCancellable *cursor_theme_warm_cancellable = NULL;
+static guint cursor_theme_warm_id = 0;
 
 /* callback used to open default browser when URLs got clicked */
 
@@ -124,6 +125,7 @@ dbus_interface_name_is_running (const gchar *name)
 	GVariantIter *iter;
 	const gchar *str = NULL;
 	gboolean result = FALSE;
+	gint64 span;
 
 	gconnection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &gerror);
 	if (gconnection == NULL) {
@@ -133,6 +135,7 @@ dbus_interface_name_is_running (const gchar *name)
 		return FALSE;
 	}
 
+	span = TRACE_BEGIN ();
 	v = g_dbus_connection_call_sync (gconnection,
 	                                 "org.freedesktop.DBus",
 	                                 "/org/freedesktop/DBus",
@@ -144,11 +147,14 @@ dbus_interface_name_is_running (const gchar *name)
 	                                 -1,
 	                                 NULL,
 	                                 &error);
+	TRACE_END (span, "dbus", "ListNames", name);
+	STATS_ADD (STATS_DBUS_CALLS, 1);
 
 	if (error) {
 		g_critical ("Could not get a list of names registered on the session bus, %s",
 		            error ? error->message : "no error given");
 		g_clear_error (&error);
+		g_object_unref (gconnection);
 		return FALSE;
 	}
 
@@ -162,6 +168,7 @@ dbus_interface_name_is_running (const gchar *name)
 
 	g_variant_iter_free (iter);
 	g_variant_unref (v);
+	g_object_unref (gconnection);
 
 	return result;
 }
@@ -173,11 +180,17 @@ process_is_running (const char * name)
 	char * command = g_strdup_printf ("pidof %s | wc -l", name);
 	FILE *fp = popen(command, "r");
 
+	g_free (command);
+
+	if (G_UNLIKELY (fp == NULL))
+		return FALSE;
+
+	/* The shell, pidof and wc. */
+	STATS_ADD (STATS_PROCESSES_SPAWNED, 3);
+
 	fscanf(fp, "%d", &num_processes);
 	pclose(fp);
 
-	g_free (command);
-
 	if (num_processes > 0) {
 		return TRUE;
 	}
@@ -199,31 +212,7 @@ need_at_enabled (void)
 static gboolean
 high_contrast_is_selected (void)
 {
-	gchar *gtk_theme = NULL;
-	gboolean high_gtk_theme;
-
-	gtk_theme = g_settings_get_string(interface_settings, KEY_GTK_THEME);
-	high_gtk_theme = (g_strcmp0(gtk_theme, HIGH_CONTRAST_THEME) == 0);
-
-	g_free (gtk_theme);
-
-	return high_gtk_theme;
-}
-
-static void
-high_contrast_checkbutton_toggled (GtkToggleButton *button,
-                                   gpointer         user_data)
-{
-	if (gtk_toggle_button_get_active (button)) {
-		g_settings_set_string (interface_settings, KEY_GTK_THEME, HIGH_CONTRAST_THEME);
-		g_settings_set_string (interface_settings, KEY_ICON_THEME, HIGH_CONTRAST_ICON_THEME);
-		g_settings_set_string (marco_settings, KEY_MARCO_THEME, HIGH_CONTRAST_MARCO_THEME);
-	}
-	else {
-		g_settings_reset (interface_settings, KEY_GTK_THEME);
-		g_settings_reset (interface_settings, KEY_ICON_THEME);
-		g_settings_reset (marco_settings, KEY_MARCO_THEME);
-	}
+	return a11y_option_get_boolean (A11Y_OPTION_HIGH_CONTRAST);
 }
 
 static double
@@ -270,30 +259,528 @@ get_dpi_from_x_server (void)
 	return dpi;
 }
 
+/* Visual options are previewed inside the dialog and only written on
+ * Aceptar, each write makes every application relayout or re-theme. */
+
+static const gdouble large_print_factors[] = {
+	DPI_FACTOR_LARGE,
+	DPI_FACTOR_LARGER,
+	DPI_FACTOR_LARGEST
+};
+
+static gboolean large_print_state_loaded = FALSE;
+
+/* A custom DPI is kept until the user picks a factor in the combo. */
+static gboolean large_print_factor_touched = FALSE;
+static gboolean large_print_syncing = FALSE;
+
+/* Factors closer than this are the same DPI. */
+#define LARGE_PRINT_FACTOR_EPSILON 0.001
+
+static GtkStyleProvider *preview_theme_provider = NULL;
+static GtkStyleProvider *preview_font_provider = NULL;
+
+typedef struct {
+	GtkStyleProvider *provider;
+	guint             priority;
+	gboolean          add;
+} PreviewRestyle;
+
+static gdouble
+large_print_candidate_factor (void)
+{
+	gdouble current;
+	gint active;
+
+	if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(high_dpi_w)))
+		return 1.0;
+
+	current = a11y_settings_get_large_print_factor ();
+	if (!large_print_factor_touched && current > 1.0)
+		return current;
+
+	active = gtk_combo_box_get_active (GTK_COMBO_BOX(large_print_factor_w));
+	if (active < 0 || active >= (gint) G_N_ELEMENTS (large_print_factors))
+		return DPI_FACTOR_LARGER;
+
+	return large_print_factors[active];
+}
+
+static void
+large_print_sync_from_settings (void)
+{
+	gdouble factor;
+	guint i, nearest = 0;
+
+	factor = a11y_settings_get_large_print_factor ();
+	for (i = 1; i < G_N_ELEMENTS (large_print_factors); i++) {
+		if (fabs (large_print_factors[i] - factor) < fabs (large_print_factors[nearest] - factor))
+			nearest = i;
+	}
+
+	/* The combo only shows the nearest preset, that is not a choice. */
+	large_print_syncing = TRUE;
+	gtk_combo_box_set_active (GTK_COMBO_BOX(large_print_factor_w),
+		factor > 1.0 ? nearest : 1);
+	large_print_syncing = FALSE;
+	large_print_factor_touched = FALSE;
+
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(high_dpi_w), factor > 1.0);
+}
+
+static void
+visual_preview_restyle (GtkWidget *widget,
+                        gpointer   user_data)
+{
+	PreviewRestyle *restyle = user_data;
+	GtkStyleContext *context;
+
+	/* Providers of a style context don't cascade to the children. */
+	context = gtk_widget_get_style_context (widget);
+	if (restyle->add)
+		gtk_style_context_add_provider (context, restyle->provider, restyle->priority);
+	else
+		gtk_style_context_remove_provider (context, restyle->provider);
+
+	if (GTK_IS_CONTAINER (widget))
+		gtk_container_forall (GTK_CONTAINER(widget), visual_preview_restyle, restyle);
+}
+
+static void
+visual_preview_set_provider (GtkStyleProvider **slot,
+                             GtkStyleProvider  *provider,
+                             guint              priority)
+{
+	PreviewRestyle restyle = { NULL, priority, FALSE };
+
+	if (*slot) {
+		restyle.provider = *slot;
+		visual_preview_restyle (visual_preview_w, &restyle);
+		g_clear_object (slot);
+	}
+
+	*slot = provider;
+
+	if (provider) {
+		restyle.provider = provider;
+		restyle.add = TRUE;
+		visual_preview_restyle (visual_preview_w, &restyle);
+	}
+}
+
+static GtkStyleProvider *
+visual_preview_theme_provider (gboolean high_contrast)
+{
+	GtkCssProvider *provider;
+	GVariant *value;
+	gchar *theme;
+
+	if (high_contrast) {
+		theme = g_strdup (HIGH_CONTRAST_THEME);
+	}
+	else {
+		value = g_settings_get_default_value (a11y_settings_get (A11Y_SCHEMA_INTERFACE), KEY_GTK_THEME);
+		theme = g_variant_dup_string (value, NULL);
+		g_variant_unref (value);
+	}
+
+	provider = gtk_css_provider_get_named (theme, NULL);
+	g_free (theme);
+
+	return provider ? g_object_ref (GTK_STYLE_PROVIDER (provider)) : NULL;
+}
+
+static GtkStyleProvider *
+visual_preview_font_provider (gdouble scale)
+{
+	GtkCssProvider *provider;
+	PangoFontDescription *desc;
+	gchar *font_name = NULL, *css;
+	gchar size[G_ASCII_DTOSTR_BUF_SIZE];
+	gdouble points = 10;
+
+	g_object_get (gtk_settings_get_default (), "gtk-font-name", &font_name, NULL);
+	desc = pango_font_description_from_string (font_name ? font_name : "Sans 10");
+	if (pango_font_description_get_size (desc) > 0)
+		points = (gdouble) pango_font_description_get_size (desc) / PANGO_SCALE;
+	pango_font_description_free (desc);
+	g_free (font_name);
+
+	/* The dialog already renders at the current DPI. */
+	css = g_strdup_printf ("* { font-size: %spt; }",
+		g_ascii_formatd (size, sizeof (size), "%.1f", points * scale));
+
+	provider = gtk_css_provider_new ();
+	gtk_css_provider_load_from_data (provider, css, -1, NULL);
+	g_free (css);
+
+	return GTK_STYLE_PROVIDER (provider);
+}
+
+static void
+visual_preview_update (void)
+{
+	gboolean high_contrast;
+	gdouble current, candidate;
+
+	high_contrast = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(high_contrast_w));
+	visual_preview_set_provider (&preview_theme_provider,
+		high_contrast != high_contrast_is_selected () ?
+			visual_preview_theme_provider (high_contrast) : NULL,
+		GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+	current = a11y_settings_get_large_print_factor ();
+	candidate = large_print_state_loaded ? large_print_candidate_factor () : current;
+	visual_preview_set_provider (&preview_font_provider,
+		candidate != current ?
+			visual_preview_font_provider (candidate / current) : NULL,
+		GTK_STYLE_PROVIDER_PRIORITY_USER);
+}
+
 static gboolean
-large_print_is_selected (void)
+visual_preview_draw (GtkWidget *widget,
+                     cairo_t   *cr,
+                     gpointer   user_data)
+{
+	/* Boxes paint no background, the sample needs the candidate one. */
+	gtk_render_background (gtk_widget_get_style_context (widget), cr, 0, 0,
+	                       gtk_widget_get_allocated_width (widget),
+	                       gtk_widget_get_allocated_height (widget));
+
+	return FALSE;
+}
+
+static GtkWidget *
+visual_preview_new (void)
 {
-	gdouble dpi = g_settings_get_double (font_settings, KEY_FONT_DPI);
-	return (dpi > get_dpi_from_x_server());
+	GtkWidget *frame, *box, *hbox, *label, *entry, *button;
+
+	frame = gtk_frame_new (NULL);
+
+	box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+	gtk_container_set_border_width (GTK_CONTAINER(box), 6);
+	gtk_style_context_add_class (gtk_widget_get_style_context (box),
+	                             GTK_STYLE_CLASS_BACKGROUND);
+	g_signal_connect (box, "draw", G_CALLBACK (visual_preview_draw), NULL);
+	gtk_container_add (GTK_CONTAINER(frame), box);
+
+	label = gtk_label_new (_("Así se verán las ventanas al aceptar los cambios."));
+	gtk_label_set_line_wrap (GTK_LABEL(label), TRUE);
+	gtk_label_set_xalign (GTK_LABEL(label), 0.0);
+	gtk_box_pack_start (GTK_BOX(box), label, FALSE, FALSE, 0);
+
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+	entry = gtk_entry_new ();
+	gtk_entry_set_text (GTK_ENTRY(entry), _("Texto de ejemplo"));
+	gtk_box_pack_start (GTK_BOX(hbox), entry, TRUE, TRUE, 0);
+	button = gtk_button_new_with_label (_("Botón"));
+	gtk_box_pack_start (GTK_BOX(hbox), button, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX(box), hbox, FALSE, FALSE, 0);
+
+	/* A sample, not a form. */
+	gtk_widget_set_can_focus (entry, FALSE);
+	gtk_widget_set_can_focus (button, FALSE);
+	gtk_editable_set_editable (GTK_EDITABLE(entry), FALSE);
+
+	return frame;
+}
+
+static void
+high_contrast_checkbutton_toggled (GtkToggleButton *button,
+                                   gpointer         user_data)
+{
+	visual_preview_update ();
 }
 
 static void
 large_print_checkbutton_toggled (GtkToggleButton *button,
                                  gpointer         user_data)
 {
-	gdouble x_dpi, u_dpi;
+	gtk_widget_set_sensitive (large_print_factor_w,
+		gtk_toggle_button_get_active (button));
+	visual_preview_update ();
+}
+
+static void
+large_print_factor_changed (GtkComboBox *combo,
+                            gpointer     user_data)
+{
+	if (!large_print_syncing)
+		large_print_factor_touched = TRUE;
+	visual_preview_update ();
+}
+
+/* Cursor size follows the nominal sizes shipped by the theme */
+
+static void
+cursor_size_scale_update_marks (GtkComboBox *combo)
+{
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	guint i, size;
+
+	if (cursor_sizes) {
+		g_array_unref (cursor_sizes);
+		cursor_sizes = NULL;
+	}
+
+	if (gtk_combo_box_get_active_iter (combo, &iter)) {
+		model = gtk_combo_box_get_model (combo);
+		gtk_tree_model_get (model, &iter, COLUMN_THEME_SIZES, &cursor_sizes, -1);
+	}
+
+	gtk_scale_clear_marks (GTK_SCALE(cursor_size_w));
+
+	if (!cursor_sizes)
+		return;
+
+	for (i = 0; i < cursor_sizes->len; i++) {
+		size = g_array_index (cursor_sizes, guint, i);
+		if (size >= CURSOR_SIZE_MIN && size <= CURSOR_SIZE_MAX)
+			gtk_scale_add_mark (GTK_SCALE(cursor_size_w), size, GTK_POS_BOTTOM, NULL);
+	}
+}
+
+static guint
+cursor_size_snap (gdouble value)
+{
+	return mouse_settings_themes_nearest_size (cursor_sizes, (guint) (value + 0.5),
+	                                           CURSOR_SIZE_MIN, CURSOR_SIZE_MAX);
+}
+
+/* Keyboard and scroll steps must move to the neighbour size instead of
+ * snapping back to the current one. */
+
+static guint
+cursor_size_step (gdouble current,
+                  gdouble value)
+{
+	guint i, size, snapped;
+
+	snapped = cursor_size_snap (value);
+
+	if (value > current && snapped <= current) {
+		for (i = 0; i < cursor_sizes->len; i++) {
+			size = g_array_index (cursor_sizes, guint, i);
+			if (size > current && size <= CURSOR_SIZE_MAX)
+				return size;
+		}
+	}
+	else if (value < current && snapped >= current) {
+		for (i = cursor_sizes->len; i > 0; i--) {
+			size = g_array_index (cursor_sizes, guint, i - 1);
+			if (size < current && size >= CURSOR_SIZE_MIN)
+				return size;
+		}
+	}
+
+	return snapped;
+}
+
+static gboolean
+cursor_size_scale_change_value (GtkRange      *range,
+                                GtkScrollType  scroll,
+                                gdouble        value,
+                                gpointer       user_data)
+{
+	if (!cursor_sizes)
+		return FALSE;
+
+	if (scroll == GTK_SCROLL_JUMP)
+		gtk_range_set_value (range, cursor_size_snap (value));
+	else
+		gtk_range_set_value (range, cursor_size_step (gtk_range_get_value (range), value));
 
-	font_settings = g_settings_new (FONT_RENDER_SCHEMA);
+	return TRUE;
+}
 
-	if (gtk_toggle_button_get_active (button)) {
-		x_dpi = get_dpi_from_x_server ();
-		u_dpi = (double)DPI_FACTOR_LARGER * x_dpi;
+/* Cursor size writes are coalesced, the dialog previews the size meanwhile */
 
-		g_settings_set_double (font_settings, KEY_FONT_DPI, u_dpi);
+static void
+cursor_size_preview_update (void)
+{
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	GdkPixbuf *pixbuf = NULL;
+	gchar *path = NULL;
+	guint size;
+
+	if (gtk_combo_box_get_active_iter (GTK_COMBO_BOX(mouse_theme_w), &iter)) {
+		model = gtk_combo_box_get_model (GTK_COMBO_BOX(mouse_theme_w));
+		gtk_tree_model_get (model, &iter, COLUMN_THEME_PATH, &path, -1);
+	}
+
+	size = (guint) gtk_range_get_value (GTK_RANGE(cursor_size_w));
+	if (path)
+		pixbuf = mouse_settings_themes_load_cursor (path, "left_ptr", size);
+
+	if (pixbuf) {
+		gtk_image_set_from_pixbuf (GTK_IMAGE(cursor_preview_w), pixbuf);
+		g_object_unref (pixbuf);
 	}
 	else {
-		g_settings_reset (font_settings, KEY_FONT_DPI);
+		gtk_image_clear (GTK_IMAGE(cursor_preview_w));
 	}
+
+	/* The busy cursor is usually animated. */
+	mouse_settings_themes_animate_image (GTK_IMAGE(cursor_busy_preview_w),
+	                                     path, "left_ptr_watch", size);
+
+	g_free (path);
+}
+
+static void
+cursor_theme_preview_update (void)
+{
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	gchar *path = NULL;
+
+	if (gtk_combo_box_get_active_iter (GTK_COMBO_BOX(mouse_theme_w), &iter)) {
+		model = gtk_combo_box_get_model (GTK_COMBO_BOX(mouse_theme_w));
+		gtk_tree_model_get (model, &iter, COLUMN_THEME_PATH, &path, -1);
+	}
+
+	/* Renders on a worker, a newer theme cancels the one in flight. */
+	mouse_settings_themes_preview_image (GTK_IMAGE(theme_preview_w), path);
+
+	g_free (path);
+}
+
+static void
+cursor_size_commit (void)
+{
+	gint size;
+
+	if (cursor_size_commit_id) {
+		g_source_remove (cursor_size_commit_id);
+		cursor_size_commit_id = 0;
+	}
+
+	size = (gint) gtk_range_get_value (GTK_RANGE(cursor_size_w));
+	a11y_option_apply (A11Y_OPTION_CURSOR_SIZE, g_variant_new_int32 (size));
+}
+
+static gboolean
+cursor_size_commit_timeout (gpointer user_data)
+{
+	cursor_size_commit_id = 0;
+	cursor_size_commit ();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+cursor_size_value_changed (GtkRange *range,
+                           gpointer  user_data)
+{
+	cursor_size_preview_update ();
+
+	if (cursor_size_commit_id)
+		g_source_remove (cursor_size_commit_id);
+	cursor_size_commit_id = g_timeout_add (CURSOR_SIZE_COMMIT_DELAY,
+	                                       cursor_size_commit_timeout, NULL);
+}
+
+static gboolean
+cursor_size_button_released (GtkWidget      *widget,
+                             GdkEventButton *event,
+                             gpointer        user_data)
+{
+	if (cursor_size_commit_id)
+		cursor_size_commit ();
+
+	return FALSE;
+}
+
+/* The cursor theme is written once its files at the current size are read
+ * ahead, or when the deadline passes. */
+
+static void
+cursor_theme_warm_cancel (void)
+{
+	if (cursor_theme_warm_id) {
+		g_source_remove (cursor_theme_warm_id);
+		cursor_theme_warm_id = 0;
+	}
+
+	g_cancellable_cancel (cursor_theme_warm_cancellable);
+	g_clear_object (&cursor_theme_warm_cancellable);
+}
+
+static void
+cursor_theme_commit (void)
+{
+	cursor_theme_warm_cancel ();
+
+	if (cursor_theme_pending) {
+		a11y_option_apply (A11Y_OPTION_CURSOR_THEME,
+		                   g_variant_new_take_string (cursor_theme_pending));
+		cursor_theme_pending = NULL;
+	}
+}
+
+static gboolean
+cursor_theme_warm_timeout (gpointer user_data)
+{
+	cursor_theme_warm_id = 0;
+	cursor_theme_commit ();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+cursor_theme_warm_ready (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+	GError *error = NULL;
+
+	/* Cancelled by a newer theme or by the deadline, nothing to do. */
+	if (!mouse_settings_themes_warm_finish (result, &error) && error) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_error_free (error);
+			return;
+		}
+		g_error_free (error);
+	}
+
+	cursor_theme_commit ();
+}
+
+static void
+cursor_theme_warm_start (gchar       *theme,
+                         const gchar *path)
+{
+	/* A newer choice replaces the one still warming. */
+	cursor_theme_warm_cancel ();
+	g_free (cursor_theme_pending);
+	cursor_theme_pending = theme;
+
+	/* The default theme has no directory to read ahead. */
+	if (path == NULL) {
+		cursor_theme_commit ();
+		return;
+	}
+
+	cursor_theme_warm_cancellable = g_cancellable_new ();
+	cursor_theme_warm_id = g_timeout_add (CURSOR_THEME_WARM_DEADLINE,
+	                                      cursor_theme_warm_timeout, NULL);
+	mouse_settings_themes_warm_async (path,
+	                                  (guint) gtk_range_get_value (GTK_RANGE(cursor_size_w)),
+	                                  cursor_theme_warm_cancellable,
+	                                  cursor_theme_warm_ready, NULL);
+}
+
+static void
+cursor_size_scale_destroy (GtkWidget *widget,
+                           gpointer   user_data)
+{
+	/* Don't lose a pending size nor theme when the dialog goes away. */
+	if (cursor_size_commit_id)
+		cursor_size_commit ();
+	if (cursor_theme_pending)
+		cursor_theme_commit ();
 }
 
 static void
@@ -302,14 +789,33 @@ icon_cursor_theme_changed (GtkComboBox *combo,
 {
 	GtkTreeModel *model;
 	GtkTreeIter iter;
-	gchar *active;
+	gchar *active, *path;
+	gdouble size;
 
-	gtk_combo_box_get_active_iter(combo, &iter);
+	/* The search may hide the active theme. */
+	if (!gtk_combo_box_get_active_iter(combo, &iter))
+		return;
 
 	model = gtk_combo_box_get_model(combo);
-	gtk_tree_model_get(model, &iter, COLUMN_THEME_NAME, &active, -1);
+	gtk_tree_model_get(model, &iter,
+	                   COLUMN_THEME_NAME, &active,
+	                   COLUMN_THEME_PATH, &path,
+	                   -1);
 
-	g_settings_set_string (mouse_settings, KEY_CURSOR_THEME, active);
+	cursor_theme_preview_update ();
+
+	/* Avoid sizes that the new theme must rescale at runtime. */
+	cursor_size_scale_update_marks (combo);
+
+	size = gtk_range_get_value (GTK_RANGE(cursor_size_w));
+	if (cursor_sizes && cursor_size_snap (size) != (guint) size)
+		gtk_range_set_value (GTK_RANGE(cursor_size_w), cursor_size_snap (size));
+	else
+		cursor_size_preview_update ();
+
+	/* After the snap, so the size read ahead is the one committed. */
+	cursor_theme_warm_start (active, path);
+	g_free (path);
 }
 
 /* Launch keyboard */
@@ -326,38 +832,57 @@ on_keyboard_accessibility_activated (GtkButton *button,
 		g_critical ("Can't launch keyboard %s", error->message);
 		g_error_free (error);
 	}
+	else {
+		STATS_ADD (STATS_PROCESSES_SPAWNED, 1);
+	}
 }
 
 /* Accessibility */
 
-#define ACCESSIBILITY_KEY       "accessibility"
-#define ACCESSIBILITY_SCHEMA    "org.mate.interface"
-
 static void
 at_enable (gboolean is_enabled)
 {
-	GSettings *settings = g_settings_new (ACCESSIBILITY_SCHEMA);
-	g_settings_set_boolean (settings, ACCESSIBILITY_KEY, is_enabled);
-	g_object_unref (settings);
+	a11y_settings_set_accessibility (is_enabled);
 }
 
 static gboolean
 at_is_enable (void)
 {
-	gboolean is_enabled = FALSE;
-	GSettings *settings = g_settings_new (ACCESSIBILITY_SCHEMA);
-	is_enabled = g_settings_get_boolean (settings, ACCESSIBILITY_KEY);
-	g_object_unref (settings);
+	return at_state_get (AT_STATE_ACCESSIBILITY);
+}
 
-	return is_enabled;
+static void
+at_state_changed_cb (AtStateField field,
+                     gboolean     value,
+                     gpointer     user_data)
+{
+	/* External changes win over the toggles, like the other settings. */
+	switch (field) {
+		case AT_STATE_SCREEN_READER:
+			gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (speacher_w), value);
+			break;
+		case AT_STATE_KEYBOARD:
+			gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (on_screen_keyboard_w), value);
+			break;
+		default:
+			break;
+	}
 }
 
-static gboolean
-at_is_active (GtkWidget *widget)
+static void
+do_logout_done (GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
 {
-	AtkObject *atkobj = NULL;
-	atkobj = gtk_widget_get_accessible (widget);
-	return GTK_IS_ACCESSIBLE (atkobj);
+	GApplication *app = user_data;
+	GError *error = NULL;
+
+	if (!do_logout_finish (result, &error)) {
+		g_warning ("Can't log out: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_application_release (app);
 }
 
 static void
@@ -365,10 +890,15 @@ do_suggest_logout_responce (GtkDialog *dialog,
                             gint       response_id,
                             gpointer   user_data)
 {
+	GApplication *app;
+
 	switch (response_id)
 	{
 		case GTK_RESPONSE_YES:
-			do_logout (NULL);
+			/* Outlive the dialog until the session manager answers. */
+			app = g_application_get_default ();
+			g_application_hold (app);
+			do_logout (NULL, do_logout_done, app);
 			break;
 		case GTK_RESPONSE_NO:
 		default:
@@ -411,38 +941,98 @@ on_screen_ruler_activated (GtkButton *button,
 		g_critical ("Can't launch screen ruler: %s", error->message);
 		g_error_free (error);
 	}
+	else {
+		STATS_ADD (STATS_PROCESSES_SPAWNED, 1);
+	}
 }
 
 /* */
 
+static gboolean
+cursor_model_find_theme (GtkTreeModel *model,
+                         const gchar  *theme,
+                         GtkTreeIter  *iter)
+{
+	gchar *value = NULL;
+	gboolean have_found = FALSE;
+
+	if (!model || !gtk_tree_model_get_iter_first (model, iter))
+		return FALSE;
+
+	do
+	{
+		gtk_tree_model_get (model, iter,
+		                    COLUMN_THEME_NAME, &value, -1);
+
+		have_found = !g_ascii_strncasecmp (value, theme, -1);
+		g_free (value);
+	} while (!have_found && gtk_tree_model_iter_next (model, iter));
+
+	return have_found;
+}
+
 static void
 cursor_combo_box_select_current_theme (GtkWidget *combo)
 {
 	GtkTreeModel *model = NULL;
 	GtkTreeIter iter;
-	gchar *theme, *value = NULL;
-	gboolean have_found = FALSE;
+	gchar *theme;
 
 	theme = g_settings_get_string (mouse_settings, KEY_CURSOR_THEME);
+	STATS_SETTINGS_READ (MOUSE_SCHEMA);
 
 	if (!theme)
 		return;
 
+	/* Themes may be still loading. */
 	model = gtk_combo_box_get_model (GTK_COMBO_BOX(combo));
-	gtk_tree_model_get_iter_first (GTK_TREE_MODEL(model), &iter);
-	do
-	{
-		gtk_tree_model_get (GTK_TREE_MODEL(model), &iter,
-		                    COLUMN_THEME_NAME, &value, -1);
-
-		if (!g_ascii_strncasecmp (value, theme, -1))
-			break;
-	} while (have_found = gtk_tree_model_iter_next (GTK_TREE_MODEL(model), &iter));
+	if (!model || !gtk_tree_model_get_iter_first (GTK_TREE_MODEL(model), &iter)) {
+		g_free (theme);
+		return;
+	}
 
-	if (have_found)
+	if (cursor_model_find_theme (model, theme, &iter))
 		gtk_combo_box_set_active_iter (GTK_COMBO_BOX (combo), &iter);
+	else if (GTK_IS_TREE_MODEL_FILTER (model) &&
+	         cursor_model_find_theme (gtk_tree_model_filter_get_model (GTK_TREE_MODEL_FILTER (model)),
+	                                  theme, &iter))
+		/* The search hides the current theme: select nothing rather
+		 * than a row that "changed" would write to the settings. */
+		gtk_combo_box_set_active (GTK_COMBO_BOX (combo), -1);
 	else
 		gtk_combo_box_set_active (GTK_COMBO_BOX (combo), 0);
+
+	g_free (theme);
+}
+
+/* Typeahead search of cursor themes */
+
+static void
+cursor_search_entry_changed (GtkSearchEntry *entry,
+                             gpointer        user_data)
+{
+	GtkTreeModel *filter;
+
+	filter = gtk_combo_box_get_model (GTK_COMBO_BOX(mouse_theme_w));
+
+	/* Filtering must never change the cursor theme by itself. */
+	g_signal_handlers_block_by_func (mouse_theme_w, icon_cursor_theme_changed, NULL);
+
+	mouse_settings_themes_filter_set_text (GTK_TREE_MODEL_FILTER(filter),
+	                                       gtk_entry_get_text (GTK_ENTRY(entry)));
+
+	if (gtk_combo_box_get_active (GTK_COMBO_BOX(mouse_theme_w)) < 0 &&
+	    gtk_entry_get_text_length (GTK_ENTRY(entry)) == 0)
+		cursor_combo_box_select_current_theme (mouse_theme_w);
+
+	g_signal_handlers_unblock_by_func (mouse_theme_w, icon_cursor_theme_changed, NULL);
+}
+
+static void
+cursor_search_entry_activate (GtkEntry *entry,
+                              gpointer  user_data)
+{
+	gtk_combo_box_popup (GTK_COMBO_BOX(mouse_theme_w));
 }
 
 /* */
@@ -450,15 +1040,16 @@ cursor_combo_box_select_current_theme (GtkWidget *combo)
 static void
 reset_custom_user_changes (void)
 {
-	g_settings_reset (font_settings, KEY_FONT_DPI);
-
-	g_settings_reset (interface_settings, KEY_GTK_THEME);
-	g_settings_reset (interface_settings, KEY_ICON_THEME);
+	/* A theme still warming would undo the reset. */
+	cursor_theme_warm_cancel ();
+	g_clear_pointer (&cursor_theme_pending, g_free);
 
-	g_settings_reset (marco_settings, KEY_MARCO_THEME);
+	a11y_settings_reset_user_changes ();
 
-	g_settings_reset (mouse_settings, KEY_CURSOR_THEME);
-	g_settings_reset (mouse_settings, KEY_CURSOR_SIZE);
+	/* Drop the previewed choices too. */
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (high_contrast_w), FALSE);
+	if (large_print_state_loaded)
+		gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (high_dpi_w), FALSE);
 
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (speacher_w), FALSE);
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (on_screen_keyboard_w), FALSE);
@@ -469,20 +1060,26 @@ reset_custom_user_changes (void)
 static void
 show_accessibility_wiki (GtkWidget *parent)
 {
-	GNetworkMonitor *nmon;
 	GError *error = NULL;
 	gboolean result;
 
-	nmon = g_network_monitor_get_default();
-	if (g_network_monitor_get_network_available(nmon)) {
-		open_url ("http://wiki.huayra.conectarigualdad.gob.ar/index.php/Accesibilidad", parent);
+	/* The wiki is only used once it is known to answer. */
+	if (wiki_probe_get_state () == WIKI_REACHABLE) {
+		open_url (WIKI_URL, parent);
+		return;
+	}
+
+	/* Meanwhile the local manual opens at once, and the wiki is probed for
+	 * the next time. */
+	wiki_probe_start ();
+
+	result = g_spawn_command_line_async ("huayra-visor-manual articles/a/c/c/Accesibilidad.html", &error);
+	if (G_UNLIKELY (result == FALSE)) {
+		g_critical ("Can't launch huayra-visor-manual: %s", error->message);
+		g_error_free (error);
 	}
 	else {
-		result = g_spawn_command_line_async ("huayra-visor-manual articles/a/c/c/Accesibilidad.html", &error);
-		if (G_UNLIKELY (result == FALSE)) {
-			g_critical ("Can't launch huayra-visor-manual: %s", error->message);
-			g_error_free (error);
-		}
+		STATS_ADD (STATS_PROCESSES_SPAWNED, 1);
 	}
 }
 
@@ -494,14 +1091,21 @@ theme_changed_cb (GSettings *settings, gchar *key, gpointer user_data)
 	if (g_strcmp0(key, KEY_GTK_THEME) == 0) {
 		gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(high_contrast_w),
 			high_contrast_is_selected());
+		visual_preview_update ();
 	}
 	else if (g_strcmp0(key, KEY_FONT_DPI) == 0) {
-		gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(high_dpi_w),
-			large_print_is_selected());
+		if (large_print_state_loaded)
+			large_print_sync_from_settings ();
+		visual_preview_update ();
 	}
 	else if (g_strcmp0(key, KEY_CURSOR_THEME) == 0) {
 		cursor_combo_box_select_current_theme (mouse_theme_w);
 	}
+	else if (g_strcmp0(key, KEY_CURSOR_SIZE) == 0) {
+		gtk_range_set_value (GTK_RANGE(cursor_size_w),
+			g_settings_get_int (settings, KEY_CURSOR_SIZE));
+		STATS_SETTINGS_READ (MOUSE_SCHEMA);
+	}
 	else {
 		g_critical ("Changed %s key", key);
 	}
@@ -509,35 +1113,181 @@ theme_changed_cb (GSettings *settings, gchar *key, gpointer user_data)
 
 /* */
 
+/* AT changes are applied in the running session through the accessibility
+ * bus. A new session is only suggested when the bus can't be reached. */
+
+typedef struct {
+	GtkWidget *dialog;
+	gboolean   screen_reader;
+	gboolean   keyboard;
+} AtChanges;
+
+static void
+at_hot_enable_done (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+	AtChanges *changes = user_data;
+	GError *error = NULL;
+
+	if (a11y_bus_set_enabled_finish (result, &error)) {
+		a11y_bus_start_helpers (changes->screen_reader, changes->keyboard);
+		if (changes->dialog)
+			gtk_widget_destroy (changes->dialog);
+	}
+	else {
+		g_message ("Can't reach the accessibility bus: %s", error->message);
+		g_error_free (error);
+		if (changes->dialog)
+			do_suggest_logout (changes->dialog);
+	}
+
+	if (changes->dialog)
+		g_object_remove_weak_pointer (G_OBJECT (changes->dialog),
+		                              (gpointer *) &changes->dialog);
+	g_slice_free (AtChanges, changes);
+
+	g_application_release (g_application_get_default ());
+}
+
 static void
 save_atk_changes (GtkWidget *widget)
 {
-	GSettings *settings = NULL;
+	AtChanges *changes;
 	gboolean new_speacher = FALSE, new_on_screen_keyboard = FALSE;
 	gboolean need_at = FALSE, at_enabled = FALSE;
 
+	/* The toggles don't reflect the settings yet. */
+	if (!at_state_loaded) {
+		gtk_widget_destroy (GTK_WIDGET(widget));
+		return;
+	}
+
 	new_speacher = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (speacher_w));
-	settings = g_settings_new (VISUAL_SCHEMA);
-	g_settings_set_boolean (settings, VISUAL_STARTUP_KEY, new_speacher);
-	g_object_unref (settings);
+	a11y_option_set_boolean (A11Y_OPTION_SCREEN_READER, new_speacher);
 
 	new_on_screen_keyboard = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (on_screen_keyboard_w));
-	settings = g_settings_new (MOBILITY_SCHEMA);
-	g_settings_set_boolean (settings, MOBILITY_STARTUP_KEY, new_on_screen_keyboard);
-	g_object_unref (settings);
+	a11y_option_set_boolean (A11Y_OPTION_KEYBOARD, new_on_screen_keyboard);
 
-	need_at = (new_speacher || new_on_screen_keyboard);
+	/* Both answered from memory, nothing here waits for the bus. */
+	need_at = need_at_enabled ();
 	at_enabled = at_is_enable ();
 
-	if (at_enabled != need_at) {
+	if (at_enabled != need_at ||
+	    (need_at && !at_state_get (AT_STATE_BUS_ENABLED))) {
 		at_enable (need_at);
-		do_suggest_logout (widget);
+
+		changes = g_slice_new (AtChanges);
+		changes->dialog = widget;
+		changes->screen_reader = new_speacher;
+		changes->keyboard = new_on_screen_keyboard;
+		g_object_add_weak_pointer (G_OBJECT (widget), (gpointer *) &changes->dialog);
+
+		gtk_dialog_set_response_sensitive (GTK_DIALOG(widget), GTK_RESPONSE_OK, FALSE);
+		g_application_hold (g_application_get_default ());
+		a11y_bus_set_enabled (need_at, NULL, at_hot_enable_done, changes);
 	}
 	else {
+		/* The bus is up already, start what was just turned on. */
+		if (need_at)
+			a11y_bus_start_helpers (new_speacher, new_on_screen_keyboard);
 		gtk_widget_destroy(GTK_WIDGET(widget));
 	}
 }
 
+typedef struct {
+	GtkWidget *dialog;
+	gboolean   high_contrast;
+	gdouble    large_print_factor;  /* < 0 when not loaded yet */
+} VisualChanges;
+
+static void
+visual_changes_commit (VisualChanges *changes)
+{
+	/* Writing an unchanged option would still apply its whole profile,
+	 * the "off" ones reset the themes and the DPI. */
+	if (changes->high_contrast != high_contrast_is_selected ())
+		a11y_option_set_boolean (A11Y_OPTION_HIGH_CONTRAST, changes->high_contrast);
+	if (changes->large_print_factor > 0 &&
+	    fabs (changes->large_print_factor - a11y_settings_get_large_print_factor ()) > LARGE_PRINT_FACTOR_EPSILON)
+		a11y_settings_set_large_print_factor (changes->large_print_factor);
+
+	g_object_unref (changes->dialog);
+	g_slice_free (VisualChanges, changes);
+}
+
+static void
+high_contrast_icon_cache_ready (GObject      *source,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+	VisualChanges *changes = user_data;
+	GtkWidget *dialog;
+	GError *error = NULL;
+
+	if (!icon_cache_update_finish (result, &error)) {
+		g_warning ("Can't update the icon cache of %s: %s",
+		           HIGH_CONTRAST_ICON_THEME, error->message);
+		g_error_free (error);
+	}
+
+	if (high_contrast_spinner_w) {
+		gtk_spinner_stop (GTK_SPINNER(high_contrast_spinner_w));
+		gtk_widget_hide (high_contrast_spinner_w);
+	}
+
+	/* The dialog may be gone, the choice is committed anyway. */
+	dialog = g_object_ref (changes->dialog);
+	visual_changes_commit (changes);
+
+	if (high_contrast_w) {
+		gtk_dialog_set_response_sensitive (GTK_DIALOG(dialog), GTK_RESPONSE_OK, TRUE);
+		gtk_dialog_set_response_sensitive (GTK_DIALOG(dialog), GTK_RESPONSE_CANCEL, TRUE);
+		save_atk_changes (dialog);
+	}
+
+	g_object_unref (dialog);
+	g_application_release (g_application_get_default ());
+}
+
+static void
+save_changes (GtkWidget *dialog)
+{
+	VisualChanges *changes;
+	gchar *theme_dir = NULL;
+
+	changes = g_slice_new (VisualChanges);
+	changes->dialog = g_object_ref (dialog);
+	changes->high_contrast = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(high_contrast_w));
+	changes->large_print_factor = large_print_state_loaded ? large_print_candidate_factor () : -1;
+
+	/* Without a valid cache every application rescans the icon theme on
+	 * the switch, rebuild it first when we are allowed to. The packaged
+	 * theme in /usr/share/icons is kept fresh by the dpkg trigger. */
+	if (changes->high_contrast && !high_contrast_is_selected ())
+		theme_dir = icon_cache_find_theme (HIGH_CONTRAST_ICON_THEME);
+
+	if (theme_dir &&
+	    !icon_cache_is_fresh (theme_dir) &&
+	    icon_cache_can_update (theme_dir)) {
+		gtk_dialog_set_response_sensitive (GTK_DIALOG(dialog), GTK_RESPONSE_OK, FALSE);
+		gtk_dialog_set_response_sensitive (GTK_DIALOG(dialog), GTK_RESPONSE_CANCEL, FALSE);
+		gtk_widget_show (high_contrast_spinner_w);
+		gtk_spinner_start (GTK_SPINNER(high_contrast_spinner_w));
+
+		g_application_hold (g_application_get_default ());
+		icon_cache_update_async (theme_dir, NULL,
+		                         high_contrast_icon_cache_ready, changes);
+		g_free (theme_dir);
+		return;
+	}
+
+	g_free (theme_dir);
+
+	visual_changes_commit (changes);
+	save_atk_changes (dialog);
+}
+
 static void
 dialog_response_cb (GtkDialog *dialog,
                     gint       response,
@@ -552,7 +1302,7 @@ dialog_response_cb (GtkDialog *dialog,
 			reset_custom_user_changes ();
 			break;
 		case GTK_RESPONSE_OK:
-			save_atk_changes (GTK_WIDGET(dialog));
+			save_changes (GTK_WIDGET(dialog));
 			break;
 		default:
 			gtk_widget_destroy(GTK_WIDGET(dialog));
@@ -560,26 +1310,263 @@ dialog_response_cb (GtkDialog *dialog,
 	}
 }
 
+/* Staged startup: the skeleton is painted first, the rest of the state
+ * arrives from idle callbacks and a worker, in priority order. */
+
+static gint64 startup_time = 0;
+static GCancellable *startup_cancellable = NULL;
+static guint startup_idle_id = 0;
+static guint startup_stage = 0;
+
+static gboolean startup_bench = FALSE;
+static gint64 startup_first_frame = 0;
+static gint64 startup_interactive = 0;
+
+static void
+startup_mark (const gchar *stage)
+{
+	g_debug ("startup: %-16s %7.1f ms", stage,
+	         (g_get_monotonic_time () - startup_time) / 1000.0);
+}
+
+static gboolean
+startup_first_draw (GtkWidget *widget,
+                    cairo_t   *cr,
+                    gpointer   user_data)
+{
+	startup_first_frame = g_get_monotonic_time ();
+	startup_mark ("first frame");
+	if (trace_enabled)
+		trace_add_span (startup_time, "startup", "first frame", NULL);
+	g_signal_handlers_disconnect_by_func (widget, startup_first_draw, user_data);
+
+	return FALSE;
+}
+
+static void
+startup_stage_large_print (void)
+{
+	large_print_sync_from_settings ();
+	large_print_state_loaded = TRUE;
+
+	ACCOUNTED_SIGNAL_CONNECT (high_dpi_w, "toggled",
+	                          large_print_checkbutton_toggled, NULL);
+	ACCOUNTED_SIGNAL_CONNECT (large_print_factor_w, "changed",
+	                          large_print_factor_changed, NULL);
+	gtk_widget_set_sensitive (high_dpi_w, TRUE);
+	gtk_widget_set_sensitive (large_print_factor_w,
+		gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(high_dpi_w)));
+}
+
+static void
+startup_stage_at (void)
+{
+	at_state_init (at_state_changed_cb, NULL);
+
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (speacher_w),
+		at_state_get (AT_STATE_SCREEN_READER));
+	gtk_widget_set_sensitive (speacher_w, TRUE);
+
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (on_screen_keyboard_w),
+		at_state_get (AT_STATE_KEYBOARD));
+	gtk_widget_set_sensitive (on_screen_keyboard_w, TRUE);
+
+	at_state_loaded = TRUE;
+}
+
+/* --startup-bench prints one JSON line and quits once the dialog settled. */
+
+static glong
+startup_bench_rss_kb (void)
+{
+	gchar *contents = NULL;
+	glong pages = 0, rss = 0;
+
+	if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL)) {
+		if (sscanf (contents, "%ld %ld", &pages, &rss) != 2)
+			rss = 0;
+		g_free (contents);
+	}
+
+	return rss * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static gboolean
+startup_bench_report (gpointer user_data)
+{
+	GtkTreeModel *model;
+
+	model = gtk_combo_box_get_model (GTK_COMBO_BOX(mouse_theme_w));
+
+	g_print ("{\"first_frame_ms\":%.1f,\"interactive_ms\":%.1f,"
+	         "\"rss_kb\":%ld,\"themes\":%d}\n",
+	         (startup_first_frame - startup_time) / 1000.0,
+	         (startup_interactive - startup_time) / 1000.0,
+	         startup_bench_rss_kb (),
+	         model ? gtk_tree_model_iter_n_children (model, NULL) : 0);
+
+	gtk_widget_destroy (window);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+startup_bench_interactive (gpointer user_data)
+{
+	/* Input is dispatched at this priority, so the dialog would answer now. */
+	startup_interactive = g_get_monotonic_time ();
+	startup_mark ("interactive");
+
+	g_timeout_add (STARTUP_BENCH_SETTLE, startup_bench_report, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+startup_cursor_themes_ready (GObject      *source,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+	GtkWidget *entry = user_data;
+	GtkListStore *store;
+	GtkTreeModel *filter;
+	GError *error = NULL;
+
+	store = mouse_settings_themes_populate_store_finish (result, &error);
+	if (store == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_warning ("Can't load cursor themes: %s", error->message);
+
+			/* The bench still reports, with no themes, and quits. */
+			if (startup_bench)
+				g_idle_add_full (G_PRIORITY_DEFAULT, startup_bench_interactive, NULL, NULL);
+		}
+		g_error_free (error);
+		return;
+	}
+
+	filter = mouse_settings_themes_filter_new (store);
+	gtk_combo_box_set_model (GTK_COMBO_BOX(mouse_theme_w), filter);
+	g_object_unref (filter);
+
+	/* Badges fill in as the worker pool reads the themes. */
+	mouse_settings_themes_analyze (store);
+	g_object_unref (store);
+
+	cursor_combo_box_select_current_theme (mouse_theme_w);
+	cursor_size_scale_update_marks (GTK_COMBO_BOX(mouse_theme_w));
+	cursor_size_preview_update ();
+	cursor_theme_preview_update ();
+
+	ACCOUNTED_SIGNAL_CONNECT (mouse_theme_w, "changed",
+	                          icon_cursor_theme_changed, NULL);
+
+	gtk_widget_set_sensitive (mouse_theme_w, TRUE);
+	gtk_widget_set_sensitive (entry, TRUE);
+
+	startup_mark ("cursor themes");
+
+	if (startup_bench)
+		g_idle_add_full (G_PRIORITY_DEFAULT, startup_bench_interactive, NULL, NULL);
+}
+
+static void
+startup_stage_cursor_themes (void)
+{
+	GtkWidget *entry;
+
+	/* The scan of icon directories runs on a worker. */
+	entry = g_object_get_data (G_OBJECT (mouse_theme_w), "search-entry");
+	mouse_settings_themes_populate_store_async (startup_cancellable,
+	                                            startup_cursor_themes_ready,
+	                                            entry);
+}
+
+static const struct {
+	const gchar *name;
+	void       (*run) (void);
+} startup_stages[] = {
+	{ "large print",   startup_stage_large_print },
+	{ "at state",      startup_stage_at },
+	{ "cursor scan",   startup_stage_cursor_themes }
+};
+
+static gboolean
+startup_next_stage (gpointer user_data)
+{
+	gint64 span;
+
+	span = TRACE_BEGIN ();
+	startup_stages[startup_stage].run ();
+	TRACE_END (span, "startup", startup_stages[startup_stage].name, NULL);
+	startup_mark (startup_stages[startup_stage].name);
+
+	/* One stage per iteration, so input and paint are never held back. */
+	if (++startup_stage < G_N_ELEMENTS (startup_stages))
+		return G_SOURCE_CONTINUE;
+
+	startup_idle_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+dialog_destroy_cb (GtkWidget *widget,
+                   gpointer   user_data)
+{
+	if (startup_idle_id) {
+		g_source_remove (startup_idle_id);
+		startup_idle_id = 0;
+	}
+
+	g_cancellable_cancel (startup_cancellable);
+	g_clear_object (&startup_cancellable);
+
+	at_state_shutdown ();
+	at_state_loaded = FALSE;
+	large_print_state_loaded = FALSE;
+
+	g_clear_object (&preview_theme_provider);
+	g_clear_object (&preview_font_provider);
+}
+
 static void
 has_activate (GtkApplication *app,
               gpointer        user_data)
 {
-	GtkWidget *table, *label, *check_button, *combo, *scale, *button;
+	GtkWidget *table, *label, *check_button, *combo, *scale, *button, *hbox, *image, *entry;
 	GtkCellRenderer *renderer;
-	GSettings *settings = NULL;
 	guint row = 0;
+	gint64 span;
+
+	/* Only one dialog, even when activated again over D-Bus. */
+
+	if (window) {
+		gtk_window_present (GTK_WINDOW (window));
+		return;
+	}
+
+	startup_mark ("activate");
+	span = TRACE_BEGIN ();
 
 	/* Settings */
 
-	mouse_settings = g_settings_new (MOUSE_SCHEMA);
-	marco_settings = g_settings_new (MARCO_SCHEMA);
-	interface_settings = g_settings_new (INTERFACE_SCHEMA);
-	font_settings = g_settings_new (FONT_RENDER_SCHEMA);
+	mouse_settings = a11y_settings_get (A11Y_SCHEMA_MOUSE);
+	marco_settings = a11y_settings_get (A11Y_SCHEMA_MARCO);
+	interface_settings = a11y_settings_get (A11Y_SCHEMA_INTERFACE);
+	font_settings = a11y_settings_get (A11Y_SCHEMA_FONT);
+
+	/* The AT helpers we ship, only written when they differ. */
+	a11y_settings_apply_at_defaults ();
 
 	/* Window */
 
 	window = gtk_dialog_new ();
 	gtk_window_set_application (GTK_WINDOW (window), app);
+	g_signal_connect (window, "destroy",
+	                  G_CALLBACK (dialog_destroy_cb), NULL);
+	g_signal_connect (window, "destroy",
+	                  G_CALLBACK (gtk_widget_destroyed), &window);
 	gtk_window_set_title (GTK_WINDOW (window), _("Opciones de accesibilidad de Huayra"));
 	gtk_window_set_icon_name (GTK_WINDOW (window), "preferences-desktop-accessibility");
 	gtk_window_set_default_size (GTK_WINDOW (window), 300, 200);
@@ -597,49 +1584,126 @@ has_activate (GtkApplication *app,
 	check_button = gtk_check_button_new_with_label (_("Realzar contraste en los colores"));
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(check_button),
 		high_contrast_is_selected());
-	huayra_hig_workarea_table_add_wide_control (table, &row, check_button);
-	g_signal_connect (check_button, "toggled",
-	                  G_CALLBACK (high_contrast_checkbutton_toggled), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (check_button, "toggled",
+	                          high_contrast_checkbutton_toggled, NULL);
 
 	high_contrast_w = check_button;
+	g_object_add_weak_pointer (G_OBJECT (check_button), (gpointer *) &high_contrast_w);
+
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+	gtk_box_pack_start (GTK_BOX(hbox), check_button, FALSE, FALSE, 0);
+
+	/* Shown while the icon cache of the theme is rebuilt. */
+	high_contrast_spinner_w = gtk_spinner_new ();
+	gtk_widget_set_no_show_all (high_contrast_spinner_w, TRUE);
+	gtk_box_pack_start (GTK_BOX(hbox), high_contrast_spinner_w, FALSE, FALSE, 0);
+	g_object_add_weak_pointer (G_OBJECT (high_contrast_spinner_w),
+	                           (gpointer *) &high_contrast_spinner_w);
+
+	huayra_hig_workarea_table_add_wide_control (table, &row, hbox);
 
 	check_button = gtk_check_button_new_with_label (_("Hacer el texto mas grande y fácil de leer"));
-	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(check_button),
-		large_print_is_selected());
-	huayra_hig_workarea_table_add_wide_control (table, &row, check_button);
-	g_signal_connect (check_button, "toggled",
-	                  G_CALLBACK (large_print_checkbutton_toggled), NULL);
+	gtk_widget_set_sensitive (check_button, FALSE);
 
 	high_dpi_w = check_button;
 
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+	gtk_box_pack_start (GTK_BOX(hbox), check_button, FALSE, FALSE, 0);
+
+	/* In the order of large_print_factors. */
+	combo = gtk_combo_box_text_new ();
+	gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(combo), _("Grande"));
+	gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(combo), _("Más grande"));
+	gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(combo), _("Muy grande"));
+	gtk_combo_box_set_active (GTK_COMBO_BOX(combo), 1);
+	gtk_widget_set_sensitive (combo, FALSE);
+	gtk_box_pack_start (GTK_BOX(hbox), combo, FALSE, FALSE, 0);
+
+	large_print_factor_w = combo;
+
+	huayra_hig_workarea_table_add_wide_control (table, &row, hbox);
+
+	visual_preview_w = visual_preview_new ();
+	huayra_hig_workarea_table_add_wide_control (table, &row, visual_preview_w);
+
 	/* Cursor */
 
+	label = gtk_label_new (_("Buscar iconos del ratón"));
+	entry = gtk_search_entry_new ();
+	gtk_widget_set_sensitive (entry, FALSE);
+	huayra_hig_workarea_table_add_row (table, &row, label, entry);
+
 	label = gtk_label_new (_("Iconos del ratón"));
-	combo = gtk_combo_box_new_with_model (GTK_TREE_MODEL(mouse_settings_themes_populate_store()));
-	cursor_combo_box_select_current_theme (combo);
-	g_signal_connect (combo, "changed",
-	                  G_CALLBACK(icon_cursor_theme_changed), NULL);
+	combo = gtk_combo_box_new ();
+	gtk_widget_set_sensitive (combo, FALSE);
+	g_object_set_data (G_OBJECT (combo), "search-entry", entry);
 
 	mouse_theme_w = combo;
 
 	renderer = gtk_cell_renderer_pixbuf_new ();
 	gtk_cell_layout_pack_start (GTK_CELL_LAYOUT(combo), renderer, TRUE);
-	gtk_cell_layout_set_attributes(GTK_CELL_LAYOUT(combo), renderer, "pixbuf", COLUMN_THEME_PIXBUF, NULL);
+	gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT(combo), renderer,
+	                                    mouse_settings_themes_preview_cell_data_func,
+	                                    NULL, NULL);
 	renderer = gtk_cell_renderer_text_new();
 	gtk_cell_layout_pack_start(GTK_CELL_LAYOUT(combo), renderer, TRUE);
 	gtk_cell_layout_set_attributes(GTK_CELL_LAYOUT(combo), renderer, "text", COLUMN_THEME_DISPLAY_NAME, NULL);
+	renderer = gtk_cell_renderer_text_new();
+	g_object_set (renderer, "scale", PANGO_SCALE_SMALL, "xalign", 1.0, NULL);
+	gtk_cell_layout_pack_start(GTK_CELL_LAYOUT(combo), renderer, FALSE);
+	gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT(combo), renderer,
+	                                    mouse_settings_themes_badge_cell_data_func,
+	                                    NULL, NULL);
 
-	huayra_hig_workarea_table_add_row (table, &row, label, combo);
+	gtk_widget_set_hexpand (combo, TRUE);
 
-	label = gtk_label_new (_("Tamaño del cursor"));
-	scale = gtk_scale_new_with_range (GTK_ORIENTATION_HORIZONTAL, 16, 128, 2);
-	gtk_scale_set_draw_value (GTK_SCALE(scale), FALSE);
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+	gtk_box_pack_start (GTK_BOX(hbox), combo, TRUE, TRUE, 0);
 
-	g_settings_bind (mouse_settings, KEY_CURSOR_SIZE,
-	                 gtk_range_get_adjustment (GTK_RANGE (scale)), "value",
-	                 G_SETTINGS_BIND_DEFAULT);
+	image = gtk_image_new ();
+	gtk_widget_set_valign (image, GTK_ALIGN_CENTER);
+	gtk_box_pack_start (GTK_BOX(hbox), image, FALSE, FALSE, 0);
+	theme_preview_w = image;
 
-	huayra_hig_workarea_table_add_row (table, &row, label, scale);
+	huayra_hig_workarea_table_add_row (table, &row, label, hbox);
+
+	label = gtk_label_new (_("Tamaño del cursor"));
+	scale = gtk_scale_new_with_range (GTK_ORIENTATION_HORIZONTAL, CURSOR_SIZE_MIN, CURSOR_SIZE_MAX, 2);
+	gtk_scale_set_draw_value (GTK_SCALE(scale), FALSE);
+	gtk_range_set_value (GTK_RANGE(scale),
+		g_settings_get_int (mouse_settings, KEY_CURSOR_SIZE));
+	STATS_SETTINGS_READ (MOUSE_SCHEMA);
+	gtk_widget_set_hexpand (scale, TRUE);
+
+	cursor_size_w = scale;
+
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+	gtk_box_pack_start (GTK_BOX(hbox), scale, TRUE, TRUE, 0);
+
+	image = gtk_image_new ();
+	gtk_widget_set_size_request (image, CURSOR_SIZE_MAX, CURSOR_SIZE_MAX);
+	gtk_box_pack_start (GTK_BOX(hbox), image, FALSE, FALSE, 0);
+	cursor_preview_w = image;
+
+	image = gtk_image_new ();
+	gtk_widget_set_size_request (image, CURSOR_SIZE_MAX, CURSOR_SIZE_MAX);
+	gtk_box_pack_start (GTK_BOX(hbox), image, FALSE, FALSE, 0);
+	cursor_busy_preview_w = image;
+
+	ACCOUNTED_SIGNAL_CONNECT (scale, "change-value",
+	                          cursor_size_scale_change_value, NULL);
+	ACCOUNTED_SIGNAL_CONNECT (scale, "value-changed",
+	                          cursor_size_value_changed, NULL);
+	ACCOUNTED_SIGNAL_CONNECT (scale, "button-release-event",
+	                          cursor_size_button_released, NULL);
+	g_signal_connect (scale, "destroy",
+	                  G_CALLBACK(cursor_size_scale_destroy), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (entry, "search-changed",
+	                          cursor_search_entry_changed, NULL);
+	ACCOUNTED_SIGNAL_CONNECT (entry, "activate",
+	                          cursor_search_entry_activate, NULL);
+
+	huayra_hig_workarea_table_add_row (table, &row, label, hbox);
 
 	/* Tools */
 
@@ -648,35 +1712,25 @@ has_activate (GtkApplication *app,
 	/* Screen Speacher. */
 
 	button = gtk_toggle_button_new_with_label (_("Utilizar lector en pantalla"));
+	gtk_widget_set_sensitive (button, FALSE);
 	huayra_hig_workarea_table_add_wide_control (table, &row, button);
 
-	settings = g_settings_new (VISUAL_SCHEMA);
-	g_settings_set_string (settings, VISUAL_KEY, "orca");
-	current_speacher = g_settings_get_boolean (settings, VISUAL_STARTUP_KEY);
-	g_object_unref (settings);
-
-	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), current_speacher);
 	speacher_w = button;
 
 	/* On Screen Keyboard. */
 
 	button = gtk_toggle_button_new_with_label (_("Utilizar teclado en pantalla"));
+	gtk_widget_set_sensitive (button, FALSE);
 	huayra_hig_workarea_table_add_wide_control (table, &row, button);
 
-	settings = g_settings_new (MOBILITY_SCHEMA);
-	g_settings_set_string (settings, MOBILITY_KEY, "onboard");
-	current_on_screen_keyboard = g_settings_get_boolean (settings, MOBILITY_STARTUP_KEY);
-	g_object_unref (settings);
-
-	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), current_on_screen_keyboard);
 	on_screen_keyboard_w = button;
 
 	/* Sreen Ruller. */
 
 	button = gtk_button_new_with_label (_("Mostrar regla en pantalla"));
 	huayra_hig_workarea_table_add_wide_control (table, &row, button);
-	g_signal_connect (button, "clicked",
-	                  G_CALLBACK(on_screen_ruler_activated), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (button, "clicked",
+	                          on_screen_ruler_activated, NULL);
 
 	/* Otras opciones */
 
@@ -684,8 +1738,8 @@ has_activate (GtkApplication *app,
 
 	button = gtk_button_new_with_label (_("Accesibilidad del teclado"));
 	huayra_hig_workarea_table_add_wide_control (table, &row, button);
-	g_signal_connect (button, "clicked",
-	                  G_CALLBACK(on_keyboard_accessibility_activated), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (button, "clicked",
+	                          on_keyboard_accessibility_activated, NULL);
 
 	/* Add table and buttons */
 
@@ -698,32 +1752,69 @@ has_activate (GtkApplication *app,
 	                        _("Ayuda"), GTK_RESPONSE_HELP,
 	                        NULL);
 
-	/* Callback to external changes. */
-
-	g_signal_connect (font_settings, "changed::"KEY_FONT_DPI,
-	                  G_CALLBACK (theme_changed_cb), NULL);
-	g_signal_connect (interface_settings, "changed::"KEY_GTK_THEME,
-	                  G_CALLBACK (theme_changed_cb), NULL);
-	g_signal_connect (interface_settings, "changed::"KEY_ICON_THEME,
-	                  G_CALLBACK (theme_changed_cb), NULL);
-	g_signal_connect (marco_settings, "changed::"KEY_MARCO_THEME,
-	                  G_CALLBACK (theme_changed_cb), NULL);
-	g_signal_connect (mouse_settings, "changed::"KEY_CURSOR_THEME,
-	                  G_CALLBACK (theme_changed_cb), NULL);
+	/* Callback to external changes, while the dialog lives. */
+
+	ACCOUNTED_SIGNAL_CONNECT_OBJECT (font_settings, "changed::"KEY_FONT_DPI,
+	                                 theme_changed_cb, window);
+	ACCOUNTED_SIGNAL_CONNECT_OBJECT (interface_settings, "changed::"KEY_GTK_THEME,
+	                                 theme_changed_cb, window);
+	ACCOUNTED_SIGNAL_CONNECT_OBJECT (interface_settings, "changed::"KEY_ICON_THEME,
+	                                 theme_changed_cb, window);
+	ACCOUNTED_SIGNAL_CONNECT_OBJECT (marco_settings, "changed::"KEY_MARCO_THEME,
+	                                 theme_changed_cb, window);
+	ACCOUNTED_SIGNAL_CONNECT_OBJECT (mouse_settings, "changed::"KEY_CURSOR_THEME,
+	                                 theme_changed_cb, window);
+	ACCOUNTED_SIGNAL_CONNECT_OBJECT (mouse_settings, "changed::"KEY_CURSOR_SIZE,
+	                                 theme_changed_cb, window);
 
 	/* Responses buttons */
 
-	g_signal_connect (window, "response",
-	                  G_CALLBACK (dialog_response_cb), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (window, "response",
+	                          dialog_response_cb, NULL);
+
+	g_signal_connect_after (window, "draw",
+	                        G_CALLBACK (startup_first_draw), NULL);
 
 	gtk_widget_show_all (window);
+
+	TRACE_END (span, "startup", "skeleton", NULL);
+	startup_mark ("skeleton");
+
+	/* Idle priority runs after the first frame is drawn. */
+	startup_cancellable = g_cancellable_new ();
+	startup_stage = 0;
+	startup_idle_id = g_idle_add (startup_next_stage, NULL);
 }
 
 static void
 has_startup (GApplication  *appn,
              gpointer       user_data)
 {
-	gtk_window_present (GTK_WINDOW (window));
+	a11y_settings_set_base_dpi (get_dpi_from_x_server ());
+	a11y_settings_snapshot ();
+
+	/* Remote toggles don't need the dialog. */
+	a11y_actions_register (G_ACTION_MAP (appn));
+	if (g_application_get_flags (appn) & G_APPLICATION_IS_SERVICE)
+		g_application_set_inactivity_timeout (appn, SERVICE_INACTIVITY_TIMEOUT);
+}
+
+static gint
+has_handle_local_options (GApplication *appn,
+                          GVariantDict *options,
+                          gpointer      user_data)
+{
+	if (g_variant_dict_contains (options, "stats"))
+		stats_enable ();
+
+	/* Measure a fresh process, never a running instance. */
+	if (g_variant_dict_contains (options, "startup-bench")) {
+		startup_bench = TRUE;
+		g_application_set_flags (appn, g_application_get_flags (appn) |
+		                               G_APPLICATION_NON_UNIQUE);
+	}
+
+	return -1;
 }
 
 int
@@ -733,22 +1824,44 @@ main (int    argc,
 	GtkApplication *app;
 	int status;
 
+	startup_time = g_get_monotonic_time ();
+	trace_init ();
+
+	/* Apply or query options without a display. */
+	if (a11y_cli_wanted (argc, argv)) {
+		status = a11y_cli_run (argc, argv);
+		trace_shutdown ();
+		return status;
+	}
+
+	/* Filling the previews or talking D-Bus is not a handler leak. */
+	alloc_accounting_add_cache (preview_cache_get_size);
+	alloc_accounting_watch_bus (G_BUS_TYPE_SESSION);
+
 	app = gtk_application_new ("org.accessibility.huayra", G_APPLICATION_FLAGS_NONE);
 	g_signal_connect (app, "activate", G_CALLBACK (has_activate), NULL);
 	g_signal_connect (app, "startup", G_CALLBACK (has_startup), NULL);
+	g_signal_connect (app, "handle-local-options",
+	                  G_CALLBACK (has_handle_local_options), NULL);
+	g_application_add_main_option (G_APPLICATION (app), "stats", 0,
+	                               G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,
+	                               _("Mostrar contadores internos al salir"), NULL);
+	g_application_add_main_option (G_APPLICATION (app), "startup-bench", 0,
+	                               G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE,
+	                               _("Medir el tiempo de inicio y salir"), NULL);
 	status = g_application_run (G_APPLICATION (app), argc, argv);
 	g_object_unref (app);
 
 	/* Free resources */
 
-	if(mouse_settings)
-		g_object_unref (mouse_settings);
-	if (marco_settings)
-		g_object_unref (marco_settings);
-	if (interface_settings)
-		g_object_unref (interface_settings);
-	if (font_settings)
-		g_object_unref (font_settings);
+	a11y_settings_shutdown ();
+
+	if (cursor_sizes)
+		g_array_unref (cursor_sizes);
+
+	alloc_accounting_report ();
+	stats_dump ();
+	trace_shutdown ();
 
 	return status;
 }
\ No newline at end of file
@@ -15,72 +15,97 @@
 /* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 /*************************************************************************/
 
-/* get_session_bus(), get_sm_proxy(), and do_logout() are all
- * based on code from mate-session-save.c from mate-session.
+/* do_logout() is based on code from mate-session-save.c from mate-session,
+ * asynchronous so the dialog never waits for the session manager.
  */
 
 #define GSM_SERVICE_DBUS   "org.mate.SessionManager"
 #define GSM_PATH_DBUS      "/org/mate/SessionManager"
 #define GSM_INTERFACE_DBUS "org.mate.SessionManager"
 
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-lowlevel.h>
-
 #include "mate-session.h"
+#include "stats.h"
+#include "trace.h"
 
-static DBusGConnection *
-get_session_bus (void)
+static void
+logout_call_done (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
 {
-        DBusGConnection *bus;
-        GError *error = NULL;
+        GTask    *task = user_data;
+        GVariant *reply;
+        GError   *error = NULL;
+        gint64   *span;
+
+        reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
 
-        bus = dbus_g_bus_get (DBUS_BUS_SESSION, &error);
+        span = g_task_get_task_data (task);
+        TRACE_END (*span, "dbus", "Logout", GSM_SERVICE_DBUS);
+        STATS_ADD (STATS_DBUS_CALLS, 1);
 
-        if (bus == NULL) {
-                g_warning ("Couldn't connect to session bus: %s", error->message);
-                g_error_free (error);
+        if (reply) {
+                g_variant_unref (reply);
+                g_task_return_boolean (task, TRUE);
+        }
+        else {
+                g_task_return_error (task, error);
         }
 
-        return bus;
+        g_object_unref (task);
 }
 
-static DBusGProxy *
-get_sm_proxy (void)
+static void
+logout_bus_ready (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
 {
-        DBusGConnection *connection;
-        DBusGProxy      *sm_proxy;
-
-        if (!(connection = get_session_bus ()))
-		return NULL;
-
-        sm_proxy = dbus_g_proxy_new_for_name (connection,
-					      GSM_SERVICE_DBUS,
-					      GSM_PATH_DBUS,
-					      GSM_INTERFACE_DBUS);
+        GTask           *task = user_data;
+        GDBusConnection *connection;
+        GError          *error = NULL;
+
+        connection = g_bus_get_finish (result, &error);
+        if (connection == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
 
-        return sm_proxy;
+        g_dbus_connection_call (connection,
+                                GSM_SERVICE_DBUS,
+                                GSM_PATH_DBUS,
+                                GSM_INTERFACE_DBUS,
+                                "Logout",
+                                g_variant_new ("(u)", 0),   /* '0' means 'log out normally' */
+                                NULL,
+                                G_DBUS_CALL_FLAGS_NONE,
+                                LOGOUT_TIMEOUT,
+                                g_task_get_cancellable (task),
+                                logout_call_done,
+                                task);
+
+        g_object_unref (connection);
 }
 
-gboolean
-do_logout (GError **err)
+void
+do_logout (GCancellable        *cancellable,
+           GAsyncReadyCallback  callback,
+           gpointer             user_data)
 {
-        DBusGProxy *sm_proxy;
-        GError     *error;
-        gboolean    res;
+        GTask  *task;
+        gint64 *span;
 
-        sm_proxy = get_sm_proxy ();
-        if (sm_proxy == NULL)
-		return FALSE;
+        task = g_task_new (NULL, cancellable, callback, user_data);
 
-        res = dbus_g_proxy_call (sm_proxy,
-                                 "Logout",
-                                 &error,
-                                 G_TYPE_UINT, 0,   /* '0' means 'log out normally' */
-                                 G_TYPE_INVALID,
-                                 G_TYPE_INVALID);
+        span = g_new (gint64, 1);
+        *span = TRACE_BEGIN ();
+        g_task_set_task_data (task, span, g_free);
 
-        if (sm_proxy)
-                g_object_unref (sm_proxy);
+        g_bus_get (G_BUS_TYPE_SESSION, cancellable, logout_bus_ready, task);
+}
 
-	return res;
+gboolean
+do_logout_finish (GAsyncResult  *result,
+                  GError       **error)
+{
+        return g_task_propagate_boolean (G_TASK (result), error);
 }
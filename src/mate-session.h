@@ -18,9 +18,21 @@
 #ifndef MATE_SESSION_H
 #define MATE_SESSION_H
 
-#include <glib.h>
+#include <gio/gio.h>
+
+/* Time allowed to the session manager to answer the logout request, in ms.
+ * The logout harness in tests/ builds with a shorter one. */
+#ifndef LOGOUT_TIMEOUT
+#define LOGOUT_TIMEOUT 5000
+#endif
+
+void
+do_logout (GCancellable        *cancellable,
+           GAsyncReadyCallback  callback,
+           gpointer             user_data);
 
 gboolean
-do_logout (GError **err);
+do_logout_finish (GAsyncResult  *result,
+                  GError       **error);
 
 #endif /* MATE_SESSION_H */
\ No newline at end of file
@@ -25,11 +25,20 @@
 #define _(x) x
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <X11/Xcursor/Xcursor.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "alloc-accounting.h"
 #include "populate-cursors.h"
+#include "preview-cache.h"
+#include "stats.h"
+#include "trace.h"
 
 /* icon names for the preview widget */
 static const gchar *preview_names[] = {
@@ -49,6 +58,12 @@ static const gchar *preview_names[] = {
 #define PREVIEW_SIZE    (24)
 #define PREVIEW_SPACING (2)
 
+/* sanity limit for the number of toc entries of a cursor file */
+#define XCURSOR_TOC_MAX (0x10000)
+
+/* cache name of the composed preview sheet, never a real cursor name */
+#define PREVIEW_SHEET_NAME ":preview-sheet"
+
 static GdkPixbuf *
 mouse_settings_themes_pixbuf_from_filename (const gchar *filename,
                                             guint        size)
@@ -59,11 +74,17 @@ mouse_settings_themes_pixbuf_from_filename (const gchar *filename,
     guchar       *buffer, *p, tmp;
     gdouble       wratio, hratio;
     gint          dest_width, dest_height;
+    gint64        span;
 
     /* load the image */
+    span = TRACE_BEGIN ();
     image = XcursorFilenameLoadImage (filename, size);
+    TRACE_END (span, "xcursor", "decode", filename);
     if (G_LIKELY (image))
     {
+        STATS_ADD (STATS_FILES_DECODED, 1);
+        STATS_ADD (STATS_BYTES_DECODED, image->width * image->height * 4);
+
         /* buffer size */
         bsize = image->width * image->height * 4;
 
@@ -101,13 +122,11 @@ mouse_settings_themes_pixbuf_from_filename (const gchar *filename,
             /* init */
             dest_width = dest_height = size;
 
-            /* set dest size */
-            /*if (hratio > wratio)
+            /* set dest size, keeping the aspect ratio */
+            if (hratio > wratio)
                 dest_width  = rint (image->width / hratio);
             else
-                dest_height = rint (image->height / wratio);*/
-            dest_height = 16;
-            dest_width = 16;
+                dest_height = rint (image->height / wratio);
 
             /* scale pixbuf */
             scaled = gdk_pixbuf_scale_simple (pixbuf, MAX (dest_width, 1), MAX (dest_height, 1), GDK_INTERP_BILINEAR);
@@ -119,6 +138,8 @@ mouse_settings_themes_pixbuf_from_filename (const gchar *filename,
 
         /* cleanup */
         XcursorImageDestroy (image);
+
+        STATS_TRACK_PIXBUF (pixbuf);
     }
 
     return pixbuf;
@@ -126,292 +147,2126 @@ mouse_settings_themes_pixbuf_from_filename (const gchar *filename,
 
 
 
-static GdkPixbuf *
-mouse_settings_themes_preview_icon (const gchar *path)
+static XcursorFileToc *
+mouse_settings_themes_read_toc (const gchar *filename,
+                                guint       *n_toc)
 {
-    GdkPixbuf *pixbuf = NULL;
-    gchar     *filename;
+    FILE           *fp;
+    guint32         header[4];
+    XcursorFileToc *toc = NULL;
+    guint           i, ntoc;
 
-    /* we only try the normal cursor, it is (most likely) always there */
-    filename = g_build_filename (path, "left_ptr", NULL);
+    *n_toc = 0;
 
-    /* try to load the pixbuf */
-    pixbuf = mouse_settings_themes_pixbuf_from_filename (filename, PREVIEW_SIZE);
+    fp = fopen (filename, "rb");
+    if (G_UNLIKELY (fp == NULL))
+        return NULL;
 
-    /* cleanup */
+    STATS_ADD (STATS_FILES_SCANNED, 1);
+
+    /* magic, header size, version and number of toc entries */
+    if (fread (header, sizeof (guint32), 4, fp) != 4
+        || GUINT32_FROM_LE (header[0]) != XCURSOR_MAGIC)
+        goto out;
+
+    ntoc = GUINT32_FROM_LE (header[3]);
+    if (ntoc == 0 || ntoc > XCURSOR_TOC_MAX)
+        goto out;
+
+    /* the toc follows the header */
+    if (fseek (fp, GUINT32_FROM_LE (header[1]), SEEK_SET) != 0)
+        goto out;
+
+    toc = g_new (XcursorFileToc, ntoc);
+    for (i = 0; i < ntoc; i++)
+    {
+        guint32 entry[3];
+
+        if (fread (entry, sizeof (guint32), 3, fp) != 3)
+        {
+            g_free (toc);
+            toc = NULL;
+            goto out;
+        }
+
+        toc[i].type = GUINT32_FROM_LE (entry[0]);
+        toc[i].subtype = GUINT32_FROM_LE (entry[1]);
+        toc[i].position = GUINT32_FROM_LE (entry[2]);
+    }
+
+    *n_toc = ntoc;
+
+out:
+    fclose (fp);
+
+    return toc;
+}
+
+
+
+static gint
+mouse_settings_themes_compare_sizes (gconstpointer a,
+                                     gconstpointer b)
+{
+    return (gint) *(const guint *) a - (gint) *(const guint *) b;
+}
+
+
+
+static GArray *
+mouse_settings_themes_nominal_sizes (const gchar *path)
+{
+    XcursorFileToc *toc;
+    GArray         *sizes;
+    gchar          *filename;
+    guint           i, j, ntoc;
+
+    /* the nominal sizes of the normal cursor stand for the whole theme */
+    filename = g_build_filename (path, "left_ptr", NULL);
+    toc = mouse_settings_themes_read_toc (filename, &ntoc);
     g_free (filename);
 
-    return pixbuf;
+    if (G_UNLIKELY (toc == NULL))
+        return NULL;
+
+    sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    for (i = 0; i < ntoc; i++)
+    {
+        if (toc[i].type != XCURSOR_IMAGE_TYPE)
+            continue;
+
+        /* animation frames repeat the size */
+        for (j = 0; j < sizes->len; j++)
+            if (g_array_index (sizes, guint, j) == toc[i].subtype)
+                break;
+
+        if (j == sizes->len)
+            g_array_append_val (sizes, toc[i].subtype);
+    }
+
+    g_array_sort (sizes, mouse_settings_themes_compare_sizes);
+
+    g_free (toc);
+
+    return sizes;
 }
 
 
 
-static void
-mouse_settings_themes_preview_image (const gchar *path,
-                                     GtkImage    *image)
+guint
+mouse_settings_themes_nearest_size (GArray *sizes,
+                                    guint   size,
+                                    guint   min_size,
+                                    guint   max_size)
+{
+    guint i, candidate, nearest = size;
+    guint distance, best = G_MAXUINT;
+
+    if (sizes == NULL)
+        return size;
+
+    for (i = 0; i < sizes->len; i++)
+    {
+        candidate = g_array_index (sizes, guint, i);
+        if (candidate < min_size || candidate > max_size)
+            continue;
+
+        distance = candidate > size ? candidate - size : size - candidate;
+        if (distance < best)
+        {
+            best = distance;
+            nearest = candidate;
+        }
+    }
+
+    return nearest;
+}
+
+
+
+GdkPixbuf *
+mouse_settings_themes_load_cursor (const gchar *path,
+                                   const gchar *name,
+                                   guint        size)
 {
     GdkPixbuf *pixbuf;
-    GdkPixbuf *preview;
-    guint      i, position;
     gchar     *filename;
-    gint       dest_x, dest_y;
 
-    /* create an empty preview image */
-    preview = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
-                              (PREVIEW_SIZE + PREVIEW_SPACING) * PREVIEW_COLUMNS - PREVIEW_SPACING,
-                              (PREVIEW_SIZE + PREVIEW_SPACING) * PREVIEW_ROWS - PREVIEW_SPACING);
+    /* hot previews come straight from the shared cache */
+    pixbuf = preview_cache_lookup (path, name, size);
+    if (pixbuf != NULL)
+        return pixbuf;
+
+    /* decode the cursor file */
+    filename = g_build_filename (path, name, NULL);
+    pixbuf = mouse_settings_themes_pixbuf_from_filename (filename, size);
+    g_free (filename);
+
+    if (G_LIKELY (pixbuf))
+        preview_cache_insert (path, name, size, pixbuf);
+
+    return pixbuf;
+}
+
+
+
+/* xcursor image chunk header: header size, type, nominal size, version,
+ * width, height, x and y hotspot, delay */
+#define XCURSOR_CHUNK_HEADER (9)
+
+/* sanity limit for the width and height of a cursor image */
+#define XCURSOR_IMAGE_MAX    (0x7fff)
+
+/* the readahead only needs the pages resident, not the pixels */
+#define WARM_BUFFER_SIZE     (64 * 1024)
+
+typedef struct
+{
+    guint32 position;
+    gsize   length;
+}
+MouseCursorChunk;
+
+
 
-    if (G_LIKELY (preview))
+static void
+mouse_settings_themes_warm_file (const gchar *filename,
+                                 guint        size)
+{
+    XcursorFileToc *toc;
+    guint           i, ntoc, distance, nearest = 0, best = G_MAXUINT;
+    guint32         header[XCURSOR_CHUNK_HEADER], width, height;
+    MouseCursorChunk chunk;
+    GArray         *chunks;
+    GStatBuf        st;
+    gsize           offset;
+    gssize          n;
+    gchar          *buffer;
+    gint            fd;
+
+    /* reading the toc already brings the head of the file in */
+    toc = mouse_settings_themes_read_toc (filename, &ntoc);
+    if (G_UNLIKELY (toc == NULL))
+        return;
+
+    /* the size libXcursor will pick for this file */
+    for (i = 0; i < ntoc; i++)
     {
-        /* make the pixbuf transparent */
-        gdk_pixbuf_fill (preview, 0x00000000);
+        if (toc[i].type != XCURSOR_IMAGE_TYPE)
+            continue;
 
-        for (i = 0, position = 0; i < G_N_ELEMENTS (preview_names); i++)
+        distance = toc[i].subtype > size ? toc[i].subtype - size : size - toc[i].subtype;
+        if (distance < best)
         {
-            /* create cursor filename and try to load the pixbuf */
-            filename = g_build_filename (path, preview_names[i], NULL);
-            pixbuf = mouse_settings_themes_pixbuf_from_filename (filename, PREVIEW_SIZE);
-            g_free (filename);
+            best = distance;
+            nearest = toc[i].subtype;
+        }
+    }
 
-            if (G_LIKELY (pixbuf))
-            {
-                /* calculate the icon position */
-                dest_x = (position % PREVIEW_COLUMNS) * (PREVIEW_SIZE + PREVIEW_SPACING);
-                dest_y = (position / PREVIEW_COLUMNS) * (PREVIEW_SIZE + PREVIEW_SPACING);
+    fd = g_open (filename, O_RDONLY, 0);
+    if (G_UNLIKELY (fd < 0))
+    {
+        g_free (toc);
+        return;
+    }
 
-                /* render it in the preview */
-                gdk_pixbuf_scale (pixbuf, preview, dest_x, dest_y,
-                                  gdk_pixbuf_get_width (pixbuf),
-                                  gdk_pixbuf_get_height (pixbuf),
-                                  dest_x, dest_y,
-                                  1.00, 1.00, GDK_INTERP_BILINEAR);
+    /* the image headers come from the file, never trust them further
+     * than its end */
+    if (G_UNLIKELY (fstat (fd, &st) != 0))
+    {
+        close (fd);
+        g_free (toc);
+        return;
+    }
 
+    chunks = g_array_new (FALSE, FALSE, sizeof (MouseCursorChunk));
 
-                /* release the pixbuf */
-                g_object_unref (G_OBJECT (pixbuf));
+    /* queue the reads of every frame at that size first, so the disk
+     * sees them together */
+    for (i = 0; i < ntoc; i++)
+    {
+        if (toc[i].type != XCURSOR_IMAGE_TYPE || toc[i].subtype != nearest)
+            continue;
 
-                /* break if we've added enough icons */
-                if (++position >= PREVIEW_ROWS * PREVIEW_COLUMNS)
-                    break;
-            }
-        }
+        if (toc[i].position >= (guint64) st.st_size)
+            continue;
 
-        /* set the image */
-        gtk_image_set_from_pixbuf (GTK_IMAGE (image), preview);
+        if (pread (fd, header, sizeof (header), toc[i].position) != sizeof (header))
+            continue;
 
-        /* release the pixbuf */
-        g_object_unref (G_OBJECT (preview));
+        width = GUINT32_FROM_LE (header[4]);
+        height = GUINT32_FROM_LE (header[5]);
+        if (width > XCURSOR_IMAGE_MAX || height > XCURSOR_IMAGE_MAX)
+            continue;
+
+        chunk.position = toc[i].position;
+        chunk.length = MIN (sizeof (header) + (gsize) width * height * 4,
+                            (gsize) st.st_size - chunk.position);
+        g_array_append_val (chunks, chunk);
+
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise (fd, chunk.position, chunk.length, POSIX_FADV_WILLNEED);
+#endif
     }
-    else
+
+    /* then wait until they are resident, through one small buffer */
+    buffer = g_malloc (WARM_BUFFER_SIZE);
+    for (i = 0; i < chunks->len; i++)
     {
-        /* clear the image */
-        gtk_image_clear (GTK_IMAGE (image));
+        chunk = g_array_index (chunks, MouseCursorChunk, i);
+        for (offset = 0; offset < chunk.length; offset += n)
+        {
+            n = pread (fd, buffer, MIN (chunk.length - offset, WARM_BUFFER_SIZE),
+                       chunk.position + offset);
+            if (n <= 0)
+                break;
+        }
     }
+    g_free (buffer);
+
+    g_array_free (chunks, TRUE);
+    close (fd);
+    g_free (toc);
 }
 
-static gint
-mouse_settings_themes_sort_func (GtkTreeModel *model,
-                                 GtkTreeIter  *a,
-                                 GtkTreeIter  *b,
-                                 gpointer      user_data)
+
+
+static void
+mouse_settings_themes_warm_thread (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
 {
-    gchar *name_a, *name_b;
-    gint   retval;
+    const gchar *path = task_data;
+    const gchar *name;
+    GHashTable  *seen;
+    GStatBuf     st;
+    GDir        *dir;
+    gchar       *filename;
+    gint64       span;
+    guint        size;
+
+    size = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (task), "size"));
+    span = TRACE_BEGIN ();
+
+    dir = g_dir_open (path, 0, NULL);
+    if (G_UNLIKELY (dir == NULL))
+    {
+        TRACE_END (span, "cursors", "warm theme", path);
+        g_task_return_boolean (task, FALSE);
+        return;
+    }
 
-    /* get the names from the model */
-    gtk_tree_model_get (model, a, COLUMN_THEME_DISPLAY_NAME, &name_a, -1);
-    gtk_tree_model_get (model, b, COLUMN_THEME_DISPLAY_NAME, &name_b, -1);
+    alloc_accounting_worker_begin ();
 
-    /* make sure the names are not null */
-    if (G_UNLIKELY (name_a == NULL))
-        name_a = g_strdup ("");
-    if (G_UNLIKELY (name_b == NULL))
-        name_b = g_strdup ("");
+    STATS_ADD (STATS_DIRS_OPENED, 1);
 
-    /* sort the names but keep Default on top */
-    if (g_utf8_collate (name_a, _("Default")) == 0)
-        retval = -1;
-    else if (g_utf8_collate (name_b, _("Default")) == 0)
-        retval = 1;
-    else
-        retval = g_utf8_collate (name_a, name_b);
+    /* most cursor names are links to a few files */
+    seen = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
 
-    /* cleanup */
-    g_free (name_a);
-    g_free (name_b);
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+        if (g_task_return_error_if_cancelled (task))
+            break;
 
-    return retval;
+        filename = g_build_filename (path, name, NULL);
+        if (g_stat (filename, &st) == 0 && S_ISREG (st.st_mode))
+        {
+            gint64 *inode = g_new (gint64, 1);
+
+            *inode = st.st_ino;
+            if (g_hash_table_add (seen, inode))
+                mouse_settings_themes_warm_file (filename, size);
+        }
+        g_free (filename);
+    }
+
+    TRACE_END (span, "cursors", "warm theme", path);
+
+    if (!g_task_had_error (task))
+        g_task_return_boolean (task, TRUE);
+
+    g_hash_table_destroy (seen);
+    g_dir_close (dir);
+
+    alloc_accounting_worker_end ();
 }
 
-GtkListStore *
-mouse_settings_themes_populate_store (void)
+
+
+void
+mouse_settings_themes_warm_async (const gchar         *path,
+                                  guint                size,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
 {
-    const gchar        *path;
-    gchar             **basedirs;
-    gint                i;
-    gchar              *homedir;
-    GDir               *dir;
-    const gchar        *theme;
-    gchar              *filename;
-    gchar              *index_file;
-    GKeyFile           *rc;
-    const gchar        *name;
-    const gchar        *comment;
-    GtkTreeIter         iter;
-    gint                position = 0;
-    GdkPixbuf          *pixbuf;
-    gchar              *active_theme = NULL;
-    GtkTreePath        *active_path = NULL;
-    GtkListStore       *store;
-    GtkCellRenderer    *renderer;
-    GtkTreeViewColumn  *column;
-    GObject            *treeview;
-    GtkTreeSelection   *selection;
-    gchar              *comment_escaped;
+    GTask *task;
 
-    /* get the cursor paths */
-#if XCURSOR_LIB_MAJOR == 1 && XCURSOR_LIB_MINOR < 1
-    path = "~/.icons:/usr/share/icons:/usr/share/pixmaps:/usr/X11R6/lib/X11/icons";
-#else
-    path = XcursorLibraryPath ();
-#endif
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_set_task_data (task, g_strdup (path), g_free);
+    g_object_set_data (G_OBJECT (task), "size", GUINT_TO_POINTER (size));
+    g_task_run_in_thread (task, mouse_settings_themes_warm_thread);
+    g_object_unref (task);
+}
 
-    /* split the paths */
-    basedirs = g_strsplit (path, ":", -1);
 
-    /* get the active theme */
-    //active_theme = xfconf_channel_get_string (xsettings_channel, "/Gtk/CursorThemeName", "default");
 
-    /* create the store */
-    store = gtk_list_store_new (N_THEME_COLUMNS, GDK_TYPE_PIXBUF, G_TYPE_STRING,
-                                G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+gboolean
+mouse_settings_themes_warm_finish (GAsyncResult  *result,
+                                   GError       **error)
+{
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
 
-    /* insert default */
-    gtk_list_store_insert_with_values (store, &iter, position++,
-                                       COLUMN_THEME_NAME, "default",
-                                       COLUMN_THEME_DISPLAY_NAME, _("Default"), -1);
 
-    /* store the default path, so we always select a theme */
-    active_path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), &iter);
 
-    if (G_LIKELY (basedirs))
+static GdkPixbuf *
+mouse_settings_themes_preview_icon (const gchar *path)
+{
+    /* we only try the normal cursor, it is (most likely) always there */
+    return mouse_settings_themes_load_cursor (path, "left_ptr", PREVIEW_SIZE);
+}
+
+
+
+/* animated cursors keep all frames of one size in a single strip */
+typedef struct
+{
+    gint        ref_count;
+    gchar      *key;
+    GdkPixbuf  *strip;
+    GdkPixbuf **frames;
+    guint      *delays;
+    guint       n_frames;
+} MouseCursorAnimation;
+
+/* animations currently alive, shared by every preview that shows them;
+ * only used from the main thread */
+static GHashTable *animation_pool = NULL;
+
+typedef struct
+{
+    GtkImage             *image;
+    gchar                *path;
+    gchar                *name;
+    guint                 size;
+    gboolean              stale;
+    GCancellable         *cancellable;
+    MouseCursorAnimation *animation;
+    guint                 frame;
+    gint64                next_frame_time;
+} MouseCursorPlayer;
+
+/* players of the mapped previews, driven by one shared frame clock */
+static GList *visible_players = NULL;
+static guint  frame_clock_id = 0;
+
+#define ANIMATION_MIN_DELAY (20)
+
+
+
+static MouseCursorAnimation *
+mouse_settings_themes_animation_decode (const gchar *filename,
+                                        guint        size)
+{
+    MouseCursorAnimation *animation;
+    XcursorImages        *images;
+    XcursorImage         *image;
+    GdkPixbuf            *strip, *frame;
+    guchar               *buffer, *row, *p, tmp;
+    guint                 i, y, width = 0, height = 0, cell_width, cell_height, nominal;
+    gsize                 stride;
+    gint64                span;
+
+    /* load all the frames of the best nominal size */
+    span = TRACE_BEGIN ();
+    images = XcursorFilenameLoadImages (filename, size);
+    TRACE_END (span, "xcursor", "decode frames", filename);
+    if (G_UNLIKELY (images == NULL))
+        return NULL;
+
+    if (G_UNLIKELY (images->nimage < 1))
     {
-        /* walk the base directories */
-        for (i = 0; basedirs[i] != NULL; i++)
-        {
-            /* init */
-            homedir = NULL;
+        XcursorImagesDestroy (images);
+        return NULL;
+    }
 
-            /* parse the homedir if needed */
-            if (strstr (basedirs[i], "~/") != NULL)
-                path = homedir = g_strconcat (g_get_home_dir (), basedirs[i] + 1, NULL);
-            else
-                path = basedirs[i];
+    /* frames usually share their size, but use the largest one */
+    for (i = 0; i < (guint) images->nimage; i++)
+    {
+        width = MAX (width, images->images[i]->width);
+        height = MAX (height, images->images[i]->height);
 
-            /* open directory */
-            dir = g_dir_open (path, 0, NULL);
-            if (G_LIKELY (dir))
-            {
-                for (;;)
-                {
-                    /* get the directory name */
-                    theme = g_dir_read_name (dir);
-                    if (G_UNLIKELY (theme == NULL))
-                        break;
+        STATS_ADD (STATS_BYTES_DECODED, images->images[i]->width * images->images[i]->height * 4);
+    }
 
-                    /* build the full cursor path */
-                    filename = g_build_filename (path, theme, "cursors", NULL);
+    STATS_ADD (STATS_FILES_DECODED, 1);
 
-                    /* check if it looks like a cursor theme */
-                    if (g_file_test (filename, G_FILE_TEST_IS_DIR))
-                    {
-                        /* try to load a pixbuf */
-                        pixbuf = mouse_settings_themes_preview_icon (filename);
-
-                        /* insert in the store */
-                        gtk_list_store_insert_with_values (store, &iter, position++,
-                                                           COLUMN_THEME_PIXBUF, pixbuf,
-                                                           COLUMN_THEME_NAME, theme,
-                                                           COLUMN_THEME_DISPLAY_NAME, theme,
-                                                           COLUMN_THEME_PATH, filename, -1);
-
-                        /* check if this is the active theme, set the path */
-                        if (active_theme && strcmp (active_theme, theme) == 0)
-                        {
-                            gtk_tree_path_free (active_path);
-                            active_path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), &iter);
-                        }
-
-                        /* release pixbuf */
-                        if (G_LIKELY (pixbuf))
-                            g_object_unref (G_OBJECT (pixbuf));
-
-                        /* check for a index.theme file for additional information */
-                        index_file = g_build_filename (path, theme, "index.theme", NULL);
-                        if (g_file_test (index_file, G_FILE_TEST_IS_REGULAR))
-                        {
-                            /* open theme desktop file */
-                            rc = g_key_file_new ();
-                            if (G_LIKELY (g_key_file_load_from_file (rc, index_file, G_KEY_FILE_NONE, NULL)))
-                            {
-                                /* check for the theme group */
-                                if (g_key_file_has_group (rc, "Icon Theme"))
-                                {
-                                    /* read values */
-                                    name = g_key_file_get_string (rc, "Icon Theme", "Name", NULL);
-                                    comment = g_key_file_get_string (rc, "Icon Theme", "Comment", NULL);
-
-                                    /* escape the comment */
-                                    comment_escaped = comment ? g_markup_escape_text (comment, -1) : NULL;
-
-                                    /* update store */
-                                    gtk_list_store_set (store, &iter,
-                                                        COLUMN_THEME_DISPLAY_NAME, name,
-                                                        COLUMN_THEME_COMMENT, comment_escaped, -1);
-
-                                    /* cleanup */
-                                    g_free (comment_escaped);
-                                }
-
-                                /* close rc file */
-                                g_key_file_free (rc);
-                            }
-                        }
+    /* one zeroed buffer holds every frame side by side */
+    stride = (gsize) width * images->nimage * 4;
+    buffer = g_malloc0 (stride * height);
 
-                        /* cleanup */
-                        g_free (index_file);
-                    }
+    animation = g_slice_new0 (MouseCursorAnimation);
+    animation->ref_count = 1;
+    animation->n_frames = images->nimage;
+    animation->frames = g_new0 (GdkPixbuf *, animation->n_frames);
+    animation->delays = g_new0 (guint, animation->n_frames);
 
-                    /* cleanup */
-                    g_free (filename);
-                }
+    for (i = 0; i < animation->n_frames; i++)
+    {
+        image = images->images[i];
 
-                /* close directory */
-                g_dir_close (dir);
+        /* copy the frame into its cell and swap bits */
+        for (y = 0; y < image->height; y++)
+        {
+            row = buffer + y * stride + (gsize) i * width * 4;
+            memcpy (row, image->pixels + y * image->width, image->width * 4);
+
+            for (p = row; p < row + image->width * 4; p += 4)
+            {
+                tmp = p[0];
+                p[0] = p[2];
+                p[2] = tmp;
             }
+        }
 
-            /* cleanup */
-            g_free (homedir);
+        animation->delays[i] = MAX (image->delay, ANIMATION_MIN_DELAY);
+    }
+
+    strip = gdk_pixbuf_new_from_data (buffer, GDK_COLORSPACE_RGB, TRUE,
+                                      8, width * animation->n_frames, height,
+                                      stride,
+                                      (GdkPixbufDestroyNotify) g_free, NULL);
+
+    /* the theme may not ship the requested size, show the cursor at the
+     * size the server will draw it */
+    nominal = images->images[0]->size;
+    if (nominal > 0 && nominal != size)
+    {
+        cell_width = MAX (1, width * size / nominal);
+        cell_height = MAX (1, height * size / nominal);
+
+        animation->strip = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                                           cell_width * animation->n_frames, cell_height);
+
+        /* frame by frame, so neighbours don't bleed into each other */
+        for (i = 0; i < animation->n_frames; i++)
+        {
+            frame = gdk_pixbuf_new_subpixbuf (strip, i * width, 0, width, height);
+            gdk_pixbuf_scale (frame, animation->strip,
+                              i * cell_width, 0, cell_width, cell_height,
+                              i * cell_width, 0,
+                              (gdouble) cell_width / width,
+                              (gdouble) cell_height / height,
+                              GDK_INTERP_BILINEAR);
+            g_object_unref (G_OBJECT (frame));
         }
 
-        /* cleanup */
-        g_strfreev (basedirs);
+        g_object_unref (G_OBJECT (strip));
+
+        width = cell_width;
+        height = cell_height;
+    }
+    else
+    {
+        animation->strip = strip;
     }
 
-    /* cleanup */
-    g_free (active_theme);
+    STATS_TRACK_PIXBUF (animation->strip);
 
-    /* setup the columns */
-    renderer = gtk_cell_renderer_pixbuf_new ();
-    column = gtk_tree_view_column_new_with_attributes ("", renderer, "pixbuf", COLUMN_THEME_PIXBUF, NULL);
+    /* frames are views into the strip, they don't copy pixels */
+    for (i = 0; i < animation->n_frames; i++)
+        animation->frames[i] = gdk_pixbuf_new_subpixbuf (animation->strip,
+                                                         i * width, 0,
+                                                         width, height);
 
-    renderer = gtk_cell_renderer_text_new ();
-    g_object_set (G_OBJECT (renderer), "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+    XcursorImagesDestroy (images);
 
-    /* sort the store */
-    gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (store), COLUMN_THEME_DISPLAY_NAME, mouse_settings_themes_sort_func, NULL, NULL);
-    gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store), COLUMN_THEME_DISPLAY_NAME, GTK_SORT_ASCENDING);
+    return animation;
+}
 
-    /* release the store */
-    return store;
+
+
+static void
+mouse_settings_themes_animation_free (MouseCursorAnimation *animation)
+{
+    guint i;
+
+    for (i = 0; i < animation->n_frames; i++)
+        g_object_unref (G_OBJECT (animation->frames[i]));
+    g_object_unref (G_OBJECT (animation->strip));
+
+    g_free (animation->frames);
+    g_free (animation->delays);
+    g_free (animation->key);
+    g_slice_free (MouseCursorAnimation, animation);
+}
+
+
+
+static void
+mouse_settings_themes_animation_unref (MouseCursorAnimation *animation)
+{
+    if (--animation->ref_count > 0)
+        return;
+
+    g_hash_table_remove (animation_pool, animation->key);
+    mouse_settings_themes_animation_free (animation);
+}
+
+
+
+static void
+mouse_settings_themes_animation_decode_thread (GTask        *task,
+                                               gpointer      source_object,
+                                               gpointer      task_data,
+                                               GCancellable *cancellable)
+{
+    MouseCursorAnimation *animation;
+    const gchar          *key = task_data;
+    gchar                *filename;
+    guint                 size;
+
+    alloc_accounting_worker_begin ();
+
+    /* the key is "<path>/<name>@<size>" */
+    filename = g_strndup (key, strrchr (key, '@') - key);
+    size = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (task), "size"));
+
+    animation = mouse_settings_themes_animation_decode (filename, size);
+    g_free (filename);
+
+    alloc_accounting_worker_end ();
+
+    if (animation != NULL)
+    {
+        animation->key = g_strdup (key);
+        g_task_return_pointer (task, animation,
+                               (GDestroyNotify) mouse_settings_themes_animation_free);
+    }
+    else
+    {
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                                 "Can't decode %s", key);
+    }
+}
+
+
+
+static gboolean mouse_settings_themes_frame_clock (gpointer user_data);
+
+static void
+mouse_settings_themes_frame_clock_schedule (void)
+{
+    MouseCursorPlayer *player;
+    GList             *li;
+    gint64             now, next = G_MAXINT64;
+
+    if (frame_clock_id != 0)
+    {
+        g_source_remove (frame_clock_id);
+        frame_clock_id = 0;
+    }
+
+    /* nothing visible to animate, stay idle */
+    for (li = visible_players; li != NULL; li = li->next)
+    {
+        player = li->data;
+        next = MIN (next, player->next_frame_time);
+    }
+
+    if (next == G_MAXINT64)
+        return;
+
+    now = g_get_monotonic_time ();
+    frame_clock_id = g_timeout_add (next > now ? (next - now) / 1000 : 0,
+                                    mouse_settings_themes_frame_clock, NULL);
+}
+
+
+
+static gboolean
+mouse_settings_themes_frame_clock (gpointer user_data)
+{
+    MouseCursorPlayer *player;
+    GList             *li;
+    gint64             now;
+
+    frame_clock_id = 0;
+    now = g_get_monotonic_time ();
+
+    for (li = visible_players; li != NULL; li = li->next)
+    {
+        player = li->data;
+        if (player->next_frame_time > now)
+            continue;
+
+        player->frame = (player->frame + 1) % player->animation->n_frames;
+        player->next_frame_time = now + player->animation->delays[player->frame] * 1000;
+
+        gtk_image_set_from_pixbuf (player->image, player->animation->frames[player->frame]);
+    }
+
+    mouse_settings_themes_frame_clock_schedule ();
+
+    return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+mouse_settings_themes_player_show (MouseCursorPlayer *player)
+{
+    gboolean playing;
+
+    playing = (g_list_find (visible_players, player) != NULL);
+
+    /* static cursors and hidden previews never need the frame clock */
+    if (player->animation == NULL
+        || player->animation->n_frames < 2
+        || !gtk_widget_get_mapped (GTK_WIDGET (player->image)))
+    {
+        if (playing)
+        {
+            visible_players = g_list_remove (visible_players, player);
+            mouse_settings_themes_frame_clock_schedule ();
+        }
+        return;
+    }
+
+    player->next_frame_time = g_get_monotonic_time ()
+                              + player->animation->delays[player->frame] * 1000;
+
+    if (!playing)
+        visible_players = g_list_prepend (visible_players, player);
+    mouse_settings_themes_frame_clock_schedule ();
+}
+
+
+
+static void
+mouse_settings_themes_player_set_animation (MouseCursorPlayer    *player,
+                                            MouseCursorAnimation *animation)
+{
+    if (player->animation != NULL)
+        mouse_settings_themes_animation_unref (player->animation);
+
+    player->animation = animation;
+    player->frame = 0;
+
+    if (animation != NULL)
+        gtk_image_set_from_pixbuf (player->image, animation->frames[0]);
+    else
+        gtk_image_clear (player->image);
+
+    mouse_settings_themes_player_show (player);
+}
+
+
+
+static void
+mouse_settings_themes_player_decoded (GObject      *source_object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+    MouseCursorPlayer    *player = user_data;
+    MouseCursorAnimation *animation, *shared;
+    GError               *error = NULL;
+
+    /* a cancelled decode may have outlived its player */
+    animation = g_task_propagate_pointer (G_TASK (result), &error);
+    if (animation == NULL)
+    {
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            g_error_free (error);
+            return;
+        }
+        g_error_free (error);
+    }
+
+    g_clear_object (&player->cancellable);
+
+    if (animation != NULL)
+    {
+        if (animation_pool == NULL)
+            animation_pool = g_hash_table_new (g_str_hash, g_str_equal);
+
+        /* another preview may have decoded the same cursor meanwhile */
+        shared = g_hash_table_lookup (animation_pool, animation->key);
+        if (shared != NULL)
+        {
+            mouse_settings_themes_animation_free (animation);
+            shared->ref_count++;
+            animation = shared;
+        }
+        else
+        {
+            g_hash_table_insert (animation_pool, animation->key, animation);
+        }
+    }
+
+    mouse_settings_themes_player_set_animation (player, animation);
+}
+
+
+
+static void
+mouse_settings_themes_player_load (MouseCursorPlayer *player)
+{
+    MouseCursorAnimation *animation = NULL;
+    GTask                *task;
+    gchar                *key;
+
+    player->stale = FALSE;
+
+    /* a newer target makes the decode in flight useless */
+    if (player->cancellable != NULL)
+    {
+        g_cancellable_cancel (player->cancellable);
+        g_clear_object (&player->cancellable);
+    }
+
+    key = g_strdup_printf ("%s/%s@%u", player->path, player->name, player->size);
+
+    /* share the strip when another preview already decoded it */
+    if (animation_pool != NULL)
+        animation = g_hash_table_lookup (animation_pool, key);
+
+    if (animation != NULL)
+    {
+        g_free (key);
+        animation->ref_count++;
+        mouse_settings_themes_player_set_animation (player, animation);
+        return;
+    }
+
+    /* decode off the main thread, the old frames stay until then */
+    player->cancellable = g_cancellable_new ();
+
+    task = g_task_new (NULL, player->cancellable,
+                       mouse_settings_themes_player_decoded, player);
+    g_task_set_task_data (task, key, g_free);
+    g_object_set_data (G_OBJECT (task), "size", GUINT_TO_POINTER (player->size));
+    g_task_run_in_thread (task, mouse_settings_themes_animation_decode_thread);
+    g_object_unref (task);
+}
+
+
+
+static void
+mouse_settings_themes_player_map (GtkWidget         *widget,
+                                  MouseCursorPlayer *player)
+{
+    /* decode lazily, the first time the preview becomes visible */
+    if (player->stale)
+        mouse_settings_themes_player_load (player);
+
+    mouse_settings_themes_player_show (player);
+}
+
+
+
+static void
+mouse_settings_themes_player_unmap (GtkWidget         *widget,
+                                    MouseCursorPlayer *player)
+{
+    if (g_list_find (visible_players, player) == NULL)
+        return;
+
+    /* hidden previews cost no cpu */
+    visible_players = g_list_remove (visible_players, player);
+    mouse_settings_themes_frame_clock_schedule ();
+}
+
+
+
+static void
+mouse_settings_themes_player_free (MouseCursorPlayer *player)
+{
+    mouse_settings_themes_player_unmap (GTK_WIDGET (player->image), player);
+
+    g_signal_handlers_disconnect_by_data (player->image, player);
+
+    if (player->cancellable != NULL)
+    {
+        g_cancellable_cancel (player->cancellable);
+        g_object_unref (player->cancellable);
+    }
+
+    if (player->animation != NULL)
+        mouse_settings_themes_animation_unref (player->animation);
+
+    g_free (player->path);
+    g_free (player->name);
+    g_slice_free (MouseCursorPlayer, player);
+}
+
+
+
+void
+mouse_settings_themes_animate_image (GtkImage    *image,
+                                     const gchar *path,
+                                     const gchar *name,
+                                     guint        size)
+{
+    MouseCursorPlayer *player;
+
+    player = g_object_get_data (G_OBJECT (image), "cursor-player");
+
+    if (path == NULL)
+    {
+        g_object_set_data (G_OBJECT (image), "cursor-player", NULL);
+        gtk_image_clear (image);
+        return;
+    }
+
+    if (player == NULL)
+    {
+        player = g_slice_new0 (MouseCursorPlayer);
+        player->image = image;
+
+        g_object_set_data_full (G_OBJECT (image), "cursor-player", player,
+                                (GDestroyNotify) mouse_settings_themes_player_free);
+
+        g_signal_connect (image, "map",
+                          G_CALLBACK (mouse_settings_themes_player_map), player);
+        g_signal_connect (image, "unmap",
+                          G_CALLBACK (mouse_settings_themes_player_unmap), player);
+    }
+    else if (player->size == size
+             && g_strcmp0 (player->path, path) == 0
+             && g_strcmp0 (player->name, name) == 0)
+    {
+        /* keep playing when nothing changed */
+        return;
+    }
+
+    /* re-target the player, a slider drag reuses it on every step */
+    g_free (player->path);
+    g_free (player->name);
+    player->path = g_strdup (path);
+    player->name = g_strdup (name);
+    player->size = size;
+    player->stale = TRUE;
+
+    if (gtk_widget_get_mapped (GTK_WIDGET (image)))
+        mouse_settings_themes_player_load (player);
+}
+
+
+
+void
+mouse_settings_themes_preview_cell_data_func (GtkCellLayout   *layout,
+                                              GtkCellRenderer *renderer,
+                                              GtkTreeModel    *model,
+                                              GtkTreeIter     *iter,
+                                              gpointer         user_data)
+{
+    GdkPixbuf *pixbuf = NULL;
+    gchar     *path;
+
+    /* the default theme has no path and no preview */
+    gtk_tree_model_get (model, iter, COLUMN_THEME_PATH, &path, -1);
+    if (path != NULL)
+        pixbuf = mouse_settings_themes_preview_icon (path);
+
+    g_object_set (renderer, "pixbuf", pixbuf, NULL);
+
+    /* cleanup */
+    if (pixbuf != NULL)
+        g_object_unref (G_OBJECT (pixbuf));
+    g_free (path);
+}
+
+
+
+static GdkPixbuf *
+mouse_settings_themes_render_sheet (const gchar  *path,
+                                    GCancellable *cancellable)
+{
+    GdkPixbuf *pixbuf;
+    GdkPixbuf *preview;
+    guint      i, position;
+    gint       dest_x, dest_y;
+
+    /* reuse the sheet if some view already composed it */
+    preview = preview_cache_lookup (path, PREVIEW_SHEET_NAME, PREVIEW_SIZE);
+    if (preview != NULL)
+        return preview;
+
+    /* create an empty preview image */
+    preview = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                              (PREVIEW_SIZE + PREVIEW_SPACING) * PREVIEW_COLUMNS - PREVIEW_SPACING,
+                              (PREVIEW_SIZE + PREVIEW_SPACING) * PREVIEW_ROWS - PREVIEW_SPACING);
+
+    if (G_UNLIKELY (preview == NULL))
+        return NULL;
+
+    STATS_TRACK_PIXBUF (preview);
+
+    /* make the pixbuf transparent */
+    gdk_pixbuf_fill (preview, 0x00000000);
+
+    for (i = 0, position = 0; i < G_N_ELEMENTS (preview_names); i++)
+    {
+        /* a newer selection made this sheet useless */
+        if (g_cancellable_is_cancelled (cancellable))
+        {
+            g_object_unref (G_OBJECT (preview));
+            return NULL;
+        }
+
+        /* try to load the pixbuf */
+        pixbuf = mouse_settings_themes_load_cursor (path, preview_names[i], PREVIEW_SIZE);
+
+        if (G_LIKELY (pixbuf))
+        {
+            /* calculate the icon position */
+            dest_x = (position % PREVIEW_COLUMNS) * (PREVIEW_SIZE + PREVIEW_SPACING);
+            dest_y = (position / PREVIEW_COLUMNS) * (PREVIEW_SIZE + PREVIEW_SPACING);
+
+            /* render it in the preview */
+            gdk_pixbuf_scale (pixbuf, preview, dest_x, dest_y,
+                              gdk_pixbuf_get_width (pixbuf),
+                              gdk_pixbuf_get_height (pixbuf),
+                              dest_x, dest_y,
+                              1.00, 1.00, GDK_INTERP_BILINEAR);
+
+
+            /* release the pixbuf */
+            g_object_unref (G_OBJECT (pixbuf));
+
+            /* break if we've added enough icons */
+            if (++position >= PREVIEW_ROWS * PREVIEW_COLUMNS)
+                break;
+        }
+    }
+
+    /* share the sheet with other views */
+    preview_cache_insert (path, PREVIEW_SHEET_NAME, PREVIEW_SIZE, preview);
+
+    return preview;
+}
+
+
+
+static void
+mouse_settings_themes_render_sheet_thread (GTask        *task,
+                                           gpointer      source_object,
+                                           gpointer      task_data,
+                                           GCancellable *cancellable)
+{
+    GdkPixbuf *preview;
+
+    alloc_accounting_worker_begin ();
+    preview = mouse_settings_themes_render_sheet (task_data, cancellable);
+    alloc_accounting_worker_end ();
+
+    if (preview != NULL)
+        g_task_return_pointer (task, preview, g_object_unref);
+    else if (!g_task_return_error_if_cancelled (task))
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED, "No preview for %s", (gchar *) task_data);
+}
+
+
+
+static void
+mouse_settings_themes_preview_image_ready (GObject      *source_object,
+                                           GAsyncResult *result,
+                                           gpointer      user_data)
+{
+    GtkImage  *image = GTK_IMAGE (user_data);
+    GdkPixbuf *preview;
+    GError    *error = NULL;
+
+    preview = g_task_propagate_pointer (G_TASK (result), &error);
+    if (preview != NULL)
+    {
+        gtk_image_set_from_pixbuf (image, preview);
+        g_object_unref (G_OBJECT (preview));
+    }
+    else
+    {
+        /* a cancelled render leaves the image to the newer one */
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            gtk_image_clear (image);
+        g_error_free (error);
+    }
+
+    g_object_unref (G_OBJECT (image));
+}
+
+
+
+static void
+mouse_settings_themes_preview_cancel (gpointer data)
+{
+    g_cancellable_cancel (G_CANCELLABLE (data));
+    g_object_unref (G_OBJECT (data));
+}
+
+
+
+void
+mouse_settings_themes_preview_image (GtkImage    *image,
+                                     const gchar *path)
+{
+    GCancellable *cancellable;
+    GdkPixbuf    *preview;
+    GTask        *task;
+
+    /* replacing the data cancels the render in flight, if any */
+    g_object_set_data (G_OBJECT (image), "preview-cancellable", NULL);
+
+    if (path == NULL)
+    {
+        gtk_image_clear (image);
+        return;
+    }
+
+    /* a cached sheet needs no worker */
+    preview = preview_cache_lookup (path, PREVIEW_SHEET_NAME, PREVIEW_SIZE);
+    if (preview != NULL)
+    {
+        gtk_image_set_from_pixbuf (image, preview);
+        g_object_unref (G_OBJECT (preview));
+        return;
+    }
+
+    cancellable = g_cancellable_new ();
+    g_object_set_data_full (G_OBJECT (image), "preview-cancellable", cancellable,
+                            mouse_settings_themes_preview_cancel);
+
+    /* the old sheet stays until the new one is ready, so the panel
+     * doesn't flicker while arrowing through the themes */
+    task = g_task_new (NULL, cancellable, mouse_settings_themes_preview_image_ready,
+                       g_object_ref (G_OBJECT (image)));
+    g_task_set_task_data (task, g_strdup (path), g_free);
+    g_task_set_return_on_cancel (task, TRUE);
+    g_task_run_in_thread (task, mouse_settings_themes_render_sheet_thread);
+    g_object_unref (task);
+}
+
+
+
+static gint
+mouse_settings_themes_sort_func (GtkTreeModel *model,
+                                 GtkTreeIter  *a,
+                                 GtkTreeIter  *b,
+                                 gpointer      user_data)
+{
+    gchar *name_a, *name_b;
+    gint   retval;
+
+    /* get the names from the model */
+    gtk_tree_model_get (model, a, COLUMN_THEME_DISPLAY_NAME, &name_a, -1);
+    gtk_tree_model_get (model, b, COLUMN_THEME_DISPLAY_NAME, &name_b, -1);
+
+    /* make sure the names are not null */
+    if (G_UNLIKELY (name_a == NULL))
+        name_a = g_strdup ("");
+    if (G_UNLIKELY (name_b == NULL))
+        name_b = g_strdup ("");
+
+    /* sort the names but keep Default on top */
+    if (g_utf8_collate (name_a, _("Default")) == 0)
+        retval = -1;
+    else if (g_utf8_collate (name_b, _("Default")) == 0)
+        retval = 1;
+    else
+        retval = g_utf8_collate (name_a, name_b);
+
+    /* cleanup */
+    g_free (name_a);
+    g_free (name_b);
+
+    return retval;
+}
+
+gchar *
+mouse_settings_themes_search_fold (const gchar *text)
+{
+    gchar *ascii, *folded;
+
+    /* strip accents and case, so "cursores" matches "Cursóres" */
+    ascii = g_str_to_ascii (text, NULL);
+    folded = g_ascii_strdown (ascii, -1);
+    g_free (ascii);
+
+    return folded;
+}
+
+
+
+static void
+mouse_settings_themes_set_search_key (GtkListStore *store,
+                                      GtkTreeIter  *iter,
+                                      GStringChunk *chunk,
+                                      const gchar  *name,
+                                      const gchar  *comment)
+{
+    gchar *text, *folded;
+
+    /* keys live as long as the store, the filter only compares them */
+    text = g_strconcat (name, "\n", comment, NULL);
+    folded = mouse_settings_themes_search_fold (text);
+
+    gtk_list_store_set (store, iter,
+                        COLUMN_THEME_SEARCH_KEY, g_string_chunk_insert (chunk, folded), -1);
+
+    g_free (folded);
+    g_free (text);
+}
+
+
+
+static gboolean
+mouse_settings_themes_filter_visible (GtkTreeModel *model,
+                                      GtkTreeIter  *iter,
+                                      gpointer      user_data)
+{
+    gchar      **needle = user_data;
+    const gchar *key;
+
+    if (*needle == NULL)
+        return TRUE;
+
+    /* pointer column, no copy */
+    gtk_tree_model_get (model, iter, COLUMN_THEME_SEARCH_KEY, &key, -1);
+
+    return key != NULL && strstr (key, *needle) != NULL;
+}
+
+
+
+static void
+mouse_settings_themes_filter_needle_free (gchar **needle)
+{
+    g_free (*needle);
+    g_free (needle);
+}
+
+
+
+GtkTreeModel *
+mouse_settings_themes_filter_new (GtkListStore *store)
+{
+    GtkTreeModel  *filter;
+    gchar        **needle;
+
+    filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (store), NULL);
+
+    needle = g_new0 (gchar *, 1);
+    g_object_set_data (G_OBJECT (filter), "search-needle", needle);
+    gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (filter),
+                                            mouse_settings_themes_filter_visible, needle,
+                                            (GDestroyNotify) mouse_settings_themes_filter_needle_free);
+
+    return filter;
+}
+
+
+
+void
+mouse_settings_themes_filter_set_text (GtkTreeModelFilter *filter,
+                                       const gchar        *text)
+{
+    gchar **needle;
+
+    needle = g_object_get_data (G_OBJECT (filter), "search-needle");
+    g_return_if_fail (needle != NULL);
+
+    /* fold the text once per keystroke, not once per row */
+    g_free (*needle);
+    *needle = (text != NULL && *text != '\0') ? mouse_settings_themes_search_fold (text) : NULL;
+
+    gtk_tree_model_filter_refilter (filter);
+}
+
+
+
+static gboolean
+mouse_settings_themes_read_index (const gchar  *basedir,
+                                  const gchar  *theme,
+                                  gchar       **name,
+                                  gchar       **comment)
+{
+    gchar    *index_file;
+    GKeyFile *rc;
+    gboolean  found = FALSE;
+
+    *name = *comment = NULL;
+
+    /* check for a index.theme file for additional information */
+    index_file = g_build_filename (basedir, theme, "index.theme", NULL);
+    if (g_file_test (index_file, G_FILE_TEST_IS_REGULAR))
+    {
+        /* open theme desktop file */
+        rc = g_key_file_new ();
+        if (G_LIKELY (g_key_file_load_from_file (rc, index_file, G_KEY_FILE_NONE, NULL)))
+        {
+            /* check for the theme group */
+            if (g_key_file_has_group (rc, "Icon Theme"))
+            {
+                /* read values */
+                *name = g_key_file_get_string (rc, "Icon Theme", "Name", NULL);
+                *comment = g_key_file_get_string (rc, "Icon Theme", "Comment", NULL);
+                found = TRUE;
+            }
+        }
+
+        /* close rc file */
+        g_key_file_free (rc);
+    }
+
+    /* cleanup */
+    g_free (index_file);
+
+    return found;
+}
+
+
+
+/* a theme found by the scan; plain data, so the scan can run on a worker
+ * thread while only the main thread touches the store */
+typedef struct
+{
+    gchar  *filename;
+    gchar  *theme;
+    gchar  *name;
+    gchar  *comment;
+    GArray *sizes;
+}
+MouseThemeRecord;
+
+
+
+static MouseThemeRecord *
+mouse_settings_themes_record_new (const gchar *filename,
+                                  const gchar *theme,
+                                  const gchar *name,
+                                  const gchar *comment,
+                                  GArray      *sizes)
+{
+    MouseThemeRecord *record;
+
+    record = g_slice_new0 (MouseThemeRecord);
+    record->filename = g_strdup (filename);
+    record->theme = g_strdup (theme);
+    record->name = g_strdup (name);
+    record->comment = g_strdup (comment);
+    record->sizes = sizes ? g_array_ref (sizes) : NULL;
+
+    STATS_ADD (STATS_THEMES_FOUND, 1);
+
+    return record;
+}
+
+
+
+static void
+mouse_settings_themes_record_free (MouseThemeRecord *record)
+{
+    if (record->sizes != NULL)
+        g_array_unref (record->sizes);
+    g_free (record->filename);
+    g_free (record->theme);
+    g_free (record->name);
+    g_free (record->comment);
+    g_slice_free (MouseThemeRecord, record);
+}
+
+
+
+static void
+mouse_settings_themes_insert (GtkListStore     *store,
+                              GStringChunk     *chunk,
+                              gint              position,
+                              MouseThemeRecord *record)
+{
+    GtkTreeIter  iter;
+    const gchar *name;
+    gchar       *comment_escaped;
+
+    name = record->name ? record->name : record->theme;
+
+    /* escape the comment */
+    comment_escaped = record->comment ? g_markup_escape_text (record->comment, -1) : NULL;
+
+    /* insert in the store, previews are loaded on demand */
+    gtk_list_store_insert_with_values (store, &iter, position,
+                                       COLUMN_THEME_NAME, record->theme,
+                                       COLUMN_THEME_DISPLAY_NAME, name,
+                                       COLUMN_THEME_COMMENT, comment_escaped,
+                                       COLUMN_THEME_PATH, record->filename,
+                                       COLUMN_THEME_SIZES, record->sizes, -1);
+
+    /* precompute the folded search key */
+    mouse_settings_themes_set_search_key (store, &iter, chunk, name, record->comment);
+
+    /* cleanup */
+    g_free (comment_escaped);
+}
+
+
+
+/* the system catalog: themes of the system icon directories, with their
+ * metadata and preview, written by the package trigger */
+#define CATALOG_TYPE "(ua(sx)a(ssssau(iiiay)))"
+
+static gint64
+mouse_settings_themes_dir_mtime (const gchar *path)
+{
+    GStatBuf st;
+
+    if (g_stat (path, &st) != 0)
+        return -1;
+
+    return st.st_mtime;
+}
+
+
+
+static GVariant *
+mouse_settings_themes_catalog_open (void)
+{
+    GMappedFile *mapped;
+    GBytes      *bytes;
+    GVariant    *catalog;
+    guint32      version;
+
+    mapped = g_mapped_file_new (CURSOR_CATALOG_FILE, FALSE, NULL);
+    if (mapped == NULL)
+        return NULL;
+
+    /* the variant reads the mapping in place, the bytes keep it alive */
+    bytes = g_mapped_file_get_bytes (mapped);
+    g_mapped_file_unref (mapped);
+
+    catalog = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (CATALOG_TYPE), bytes, FALSE));
+    g_bytes_unref (bytes);
+
+    g_variant_get_child (catalog, 0, "u", &version);
+    if (version != CURSOR_CATALOG_VERSION)
+    {
+        g_variant_unref (catalog);
+        return NULL;
+    }
+
+    return catalog;
+}
+
+
+
+/* the catalog covers a directory only while the directory is unchanged */
+static gboolean
+mouse_settings_themes_catalog_covers (GVariant    *catalog,
+                                      const gchar *basedir)
+{
+    GVariantIter  iter;
+    GVariant     *dirs;
+    const gchar  *path;
+    gint64        mtime;
+    gboolean      covered = FALSE;
+
+    dirs = g_variant_get_child_value (catalog, 1);
+    g_variant_iter_init (&iter, dirs);
+    while (!covered && g_variant_iter_next (&iter, "(&sx)", &path, &mtime))
+        covered = (strcmp (path, basedir) == 0 && mouse_settings_themes_dir_mtime (basedir) == mtime);
+    g_variant_unref (dirs);
+
+    return covered;
+}
+
+
+
+static GdkPixbuf *
+mouse_settings_themes_catalog_preview (GVariant *preview)
+{
+    GVariant  *pixels;
+    GBytes    *bytes;
+    GdkPixbuf *pixbuf = NULL;
+    gint32     width, height, rowstride;
+
+    g_variant_get (preview, "(iii@ay)", &width, &height, &rowstride, &pixels);
+
+    /* the pixels point into the mapped catalog */
+    bytes = g_variant_get_data_as_bytes (pixels);
+    if (width > 0 && height > 0 && rowstride >= width * 4
+        && g_bytes_get_size (bytes) >= (gsize) rowstride * (height - 1) + width * 4)
+        pixbuf = gdk_pixbuf_new_from_bytes (bytes, GDK_COLORSPACE_RGB, TRUE, 8,
+                                            width, height, rowstride);
+
+    g_bytes_unref (bytes);
+    g_variant_unref (pixels);
+
+    return pixbuf;
+}
+
+
+
+static void
+mouse_settings_themes_catalog_collect (GVariant    *catalog,
+                                       const gchar *basedir,
+                                       GPtrArray   *records)
+{
+    GVariantIter   iter;
+    GVariant      *themes, *sizes_variant, *preview_variant;
+    const gchar   *dir, *theme, *name, *comment;
+    const guint32 *values;
+    gsize          n_values;
+    GArray        *sizes;
+    GdkPixbuf     *preview;
+    gchar         *filename;
+
+    themes = g_variant_get_child_value (catalog, 2);
+    g_variant_iter_init (&iter, themes);
+    while (g_variant_iter_next (&iter, "(&s&s&s&s@au@(iiiay))", &dir, &theme, &name, &comment,
+                                &sizes_variant, &preview_variant))
+    {
+        if (strcmp (dir, basedir) == 0)
+        {
+            filename = g_build_filename (basedir, theme, "cursors", NULL);
+
+            values = g_variant_get_fixed_array (sizes_variant, &n_values, sizeof (guint32));
+            sizes = NULL;
+            if (n_values > 0)
+            {
+                sizes = g_array_sized_new (FALSE, FALSE, sizeof (guint), n_values);
+                g_array_append_vals (sizes, values, n_values);
+            }
+
+            g_ptr_array_add (records,
+                             mouse_settings_themes_record_new (filename, theme,
+                                                               *name ? name : NULL,
+                                                               *comment ? comment : NULL,
+                                                               sizes));
+
+            /* seed the shared cache, so the combo never decodes the preview */
+            preview = mouse_settings_themes_catalog_preview (preview_variant);
+            if (preview)
+            {
+                preview_cache_insert (filename, "left_ptr", PREVIEW_SIZE, preview);
+                g_object_unref (G_OBJECT (preview));
+            }
+
+            if (sizes != NULL)
+                g_array_unref (sizes);
+            g_free (filename);
+        }
+
+        g_variant_unref (sizes_variant);
+        g_variant_unref (preview_variant);
+    }
+    g_variant_unref (themes);
+}
+
+
+
+static gchar **
+mouse_settings_themes_get_basedirs (void)
+{
+    const gchar *path;
+
+    /* get the cursor paths */
+#if XCURSOR_LIB_MAJOR == 1 && XCURSOR_LIB_MINOR < 1
+    path = "~/.icons:/usr/share/icons:/usr/share/pixmaps:/usr/X11R6/lib/X11/icons";
+#else
+    path = XcursorLibraryPath ();
+#endif
+
+    /* split the paths */
+    return g_strsplit (path, ":", -1);
+}
+
+
+
+static GPtrArray *
+mouse_settings_themes_scan (void)
+{
+    const gchar        *path;
+    gchar             **basedirs;
+    gint                i;
+    gchar              *homedir;
+    GDir               *dir;
+    const gchar        *theme;
+    gchar              *filename;
+    gchar              *name;
+    gchar              *comment;
+    GPtrArray          *records;
+    GArray             *sizes;
+    GVariant           *catalog;
+    gint64              span;
+
+    span = TRACE_BEGIN ();
+
+    basedirs = mouse_settings_themes_get_basedirs ();
+
+    /* themes of the system directories come from the shared catalog */
+    catalog = mouse_settings_themes_catalog_open ();
+
+    records = g_ptr_array_new_with_free_func ((GDestroyNotify) mouse_settings_themes_record_free);
+
+    if (G_LIKELY (basedirs))
+    {
+        /* walk the base directories */
+        for (i = 0; basedirs[i] != NULL; i++)
+        {
+            /* init */
+            homedir = NULL;
+
+            /* parse the homedir if needed */
+            if (strstr (basedirs[i], "~/") != NULL)
+                path = homedir = g_strconcat (g_get_home_dir (), basedirs[i] + 1, NULL);
+            else
+                path = basedirs[i];
+
+            /* per-user directories are always scanned */
+            if (homedir == NULL && catalog && mouse_settings_themes_catalog_covers (catalog, path))
+            {
+                mouse_settings_themes_catalog_collect (catalog, path, records);
+                continue;
+            }
+
+            /* open directory */
+            dir = g_dir_open (path, 0, NULL);
+            if (G_LIKELY (dir))
+            {
+                STATS_ADD (STATS_DIRS_OPENED, 1);
+
+                for (;;)
+                {
+                    /* get the directory name */
+                    theme = g_dir_read_name (dir);
+                    if (G_UNLIKELY (theme == NULL))
+                        break;
+
+                    /* build the full cursor path */
+                    filename = g_build_filename (path, theme, "cursors", NULL);
+
+                    /* check if it looks like a cursor theme */
+                    if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+                    {
+                        /* read the nominal sizes the theme ships */
+                        sizes = mouse_settings_themes_nominal_sizes (filename);
+
+                        mouse_settings_themes_read_index (path, theme, &name, &comment);
+                        g_ptr_array_add (records,
+                                         mouse_settings_themes_record_new (filename, theme,
+                                                                           name, comment, sizes));
+
+                        /* cleanup */
+                        if (sizes != NULL)
+                            g_array_unref (sizes);
+                        g_free (name);
+                        g_free (comment);
+                    }
+
+                    /* cleanup */
+                    g_free (filename);
+                }
+
+                /* close directory */
+                g_dir_close (dir);
+            }
+
+            /* cleanup */
+            g_free (homedir);
+        }
+
+        /* cleanup */
+        g_strfreev (basedirs);
+    }
+
+    if (catalog)
+        g_variant_unref (catalog);
+
+    TRACE_END (span, "themes", "scan", NULL);
+
+    return records;
+}
+
+
+
+static GtkListStore *
+mouse_settings_themes_store_new (GPtrArray *records)
+{
+    GtkTreeIter         iter;
+    gint                position = 0;
+    GtkListStore       *store;
+    GStringChunk       *chunk;
+    guint               i;
+    gint64              span;
+
+    span = TRACE_BEGIN ();
+
+    /* create the store */
+    store = gtk_list_store_new (N_THEME_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
+                                G_TYPE_STRING, G_TYPE_STRING, G_TYPE_ARRAY,
+                                G_TYPE_POINTER, G_TYPE_UINT, G_TYPE_UINT,
+                                G_TYPE_BOOLEAN);
+
+    /* the search keys are owned by the store */
+    chunk = g_string_chunk_new (1024);
+    g_object_set_data_full (G_OBJECT (store), "search-keys", chunk,
+                            (GDestroyNotify) g_string_chunk_free);
+
+    /* insert default */
+    gtk_list_store_insert_with_values (store, &iter, position++,
+                                       COLUMN_THEME_NAME, "default",
+                                       COLUMN_THEME_DISPLAY_NAME, _("Default"), -1);
+    mouse_settings_themes_set_search_key (store, &iter, chunk, _("Default"), NULL);
+
+    for (i = 0; i < records->len; i++)
+        mouse_settings_themes_insert (store, chunk, position++, g_ptr_array_index (records, i));
+
+    /* sort the store */
+    gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (store), COLUMN_THEME_DISPLAY_NAME, mouse_settings_themes_sort_func, NULL, NULL);
+    gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store), COLUMN_THEME_DISPLAY_NAME, GTK_SORT_ASCENDING);
+
+    /* release the store */
+    TRACE_END (span, "themes", "populate store", NULL);
+
+    return store;
+}
+
+
+
+GtkListStore *
+mouse_settings_themes_populate_store (void)
+{
+    GPtrArray    *records;
+    GtkListStore *store;
+
+    records = mouse_settings_themes_scan ();
+    store = mouse_settings_themes_store_new (records);
+    g_ptr_array_unref (records);
+
+    return store;
+}
+
+
+
+gboolean
+mouse_settings_themes_build_catalog (const gchar  *filename,
+                                     GError      **error)
+{
+    gchar           **basedirs;
+    GVariantBuilder   dirs, themes, sizes_builder;
+    GDir             *dir;
+    const gchar      *theme;
+    gchar            *path, *name, *comment;
+    GArray           *sizes;
+    GdkPixbuf        *preview;
+    GVariant         *pixels, *catalog;
+    gchar            *dirname;
+    gboolean          result;
+    guint             i, j;
+
+    basedirs = mouse_settings_themes_get_basedirs ();
+
+    g_variant_builder_init (&dirs, G_VARIANT_TYPE ("a(sx)"));
+    g_variant_builder_init (&themes, G_VARIANT_TYPE ("a(ssssau(iiiay))"));
+
+    for (i = 0; basedirs[i] != NULL; i++)
+    {
+        /* only directories shared by every user */
+        if (strstr (basedirs[i], "~/") != NULL || !g_path_is_absolute (basedirs[i]))
+            continue;
+
+        dir = g_dir_open (basedirs[i], 0, NULL);
+        if (dir == NULL)
+            continue;
+
+        g_variant_builder_add (&dirs, "(sx)", basedirs[i], mouse_settings_themes_dir_mtime (basedirs[i]));
+
+        while ((theme = g_dir_read_name (dir)) != NULL)
+        {
+            path = g_build_filename (basedirs[i], theme, "cursors", NULL);
+
+            if (g_file_test (path, G_FILE_TEST_IS_DIR))
+            {
+                sizes = mouse_settings_themes_nominal_sizes (path);
+                g_variant_builder_init (&sizes_builder, G_VARIANT_TYPE ("au"));
+                for (j = 0; sizes != NULL && j < sizes->len; j++)
+                    g_variant_builder_add (&sizes_builder, "u", g_array_index (sizes, guint, j));
+
+                mouse_settings_themes_read_index (basedirs[i], theme, &name, &comment);
+
+                preview = mouse_settings_themes_preview_icon (path);
+                if (preview)
+                    pixels = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                        gdk_pixbuf_read_pixels (preview),
+                                                        gdk_pixbuf_get_byte_length (preview), 1);
+                else
+                    pixels = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, NULL, 0, 1);
+
+                g_variant_builder_add (&themes, "(ssssau(iii@ay))", basedirs[i], theme,
+                                       name ? name : "", comment ? comment : "", &sizes_builder,
+                                       preview ? gdk_pixbuf_get_width (preview) : 0,
+                                       preview ? gdk_pixbuf_get_height (preview) : 0,
+                                       preview ? gdk_pixbuf_get_rowstride (preview) : 0,
+                                       pixels);
+
+                if (preview)
+                    g_object_unref (G_OBJECT (preview));
+                if (sizes != NULL)
+                    g_array_unref (sizes);
+                g_free (name);
+                g_free (comment);
+            }
+
+            g_free (path);
+        }
+
+        g_dir_close (dir);
+    }
+
+    g_strfreev (basedirs);
+
+    catalog = g_variant_ref_sink (g_variant_new ("(ua(sx)a(ssssau(iiiay)))", CURSOR_CATALOG_VERSION,
+                                                 &dirs, &themes));
+
+    /* written aside and renamed, running instances keep their mapping */
+    dirname = g_path_get_dirname (filename);
+    result = g_mkdir_with_parents (dirname, 0755) == 0
+             && g_file_set_contents (filename, g_variant_get_data (catalog),
+                                     g_variant_get_size (catalog), error);
+    if (!result && error && *error == NULL)
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "Can't create %s", dirname);
+
+    g_free (dirname);
+    g_variant_unref (catalog);
+
+    return result;
+}
+
+
+
+static void
+mouse_settings_themes_populate_thread (GTask        *task,
+                                       gpointer      source_object,
+                                       gpointer      task_data,
+                                       GCancellable *cancellable)
+{
+    GPtrArray *records;
+
+    /* only plain data here, the store is built by the finish */
+    alloc_accounting_worker_begin ();
+    records = mouse_settings_themes_scan ();
+    alloc_accounting_worker_end ();
+
+    g_task_return_pointer (task, records, (GDestroyNotify) g_ptr_array_unref);
+}
+
+
+
+void
+mouse_settings_themes_populate_store_async (GCancellable        *cancellable,
+                                            GAsyncReadyCallback  callback,
+                                            gpointer             user_data)
+{
+    GTask *task;
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_run_in_thread (task, mouse_settings_themes_populate_thread);
+    g_object_unref (task);
+}
+
+
+
+GtkListStore *
+mouse_settings_themes_populate_store_finish (GAsyncResult  *result,
+                                             GError       **error)
+{
+    GPtrArray    *records;
+    GtkListStore *store;
+
+    records = g_task_propagate_pointer (G_TASK (result), error);
+    if (records == NULL)
+        return NULL;
+
+    /* runs in the main thread, like every other use of the store */
+    store = mouse_settings_themes_store_new (records);
+    g_ptr_array_unref (records);
+
+    return store;
+}
+
+
+
+/* background analysis of the theme capabilities, from the Xcursor tables
+ * of contents only; the results are kept per user across sessions */
+#define ANALYSIS_MAX_THREADS (4)
+#define ANALYSIS_LARGE_SIZE  (48)
+
+/* bump when the analysis changes, older cached results are redone */
+#define ANALYSIS_VERSION     (1)
+
+/* the cursors the desktop asks for; a theme missing any of them falls
+ * back to the core font for that cursor */
+static const gchar *coverage_names[] = {
+    "left_ptr",            "left_ptr_watch",      "watch",            "hand2",
+    "xterm",               "question_arrow",      "crosshair",        "fleur",
+    "sb_h_double_arrow",   "sb_v_double_arrow",   "top_side",         "bottom_side",
+    "left_side",           "right_side",          "top_left_corner",  "top_right_corner",
+    "bottom_left_corner",  "bottom_right_corner"
+};
+
+typedef struct
+{
+    gchar               *path;
+    GtkTreeRowReference *row;      /* only used in the main thread */
+    gint64               mtime;
+    guint                coverage;
+    guint                frames;
+}
+MouseThemeAnalysis;
+
+static GThreadPool *analysis_pool = NULL;
+static GKeyFile    *analysis_cache = NULL;
+static guint        analysis_pending = 0;
+
+
+
+static gchar *
+mouse_settings_themes_analysis_cache_file (void)
+{
+    return g_build_filename (g_get_user_cache_dir (), "huayra-accessibility-settings", "themes.cache", NULL);
+}
+
+
+
+static void
+mouse_settings_themes_analysis_free (MouseThemeAnalysis *analysis)
+{
+    if (analysis->row != NULL)
+        gtk_tree_row_reference_free (analysis->row);
+    g_free (analysis->path);
+    g_slice_free (MouseThemeAnalysis, analysis);
+}
+
+
+
+static void
+mouse_settings_themes_analysis_set (MouseThemeAnalysis *analysis)
+{
+    GtkTreeModel *model;
+    GtkTreePath  *path;
+    GtkTreeIter   iter;
+
+    if (!gtk_tree_row_reference_valid (analysis->row))
+        return;
+
+    model = gtk_tree_row_reference_get_model (analysis->row);
+    path = gtk_tree_row_reference_get_path (analysis->row);
+
+    if (gtk_tree_model_get_iter (model, &iter, path))
+        gtk_list_store_set (GTK_LIST_STORE (model), &iter,
+                            COLUMN_THEME_COVERAGE, analysis->coverage,
+                            COLUMN_THEME_FRAMES, analysis->frames,
+                            COLUMN_THEME_ANALYZED, TRUE, -1);
+
+    gtk_tree_path_free (path);
+}
+
+
+
+static gboolean
+mouse_settings_themes_analysis_done (gpointer user_data)
+{
+    MouseThemeAnalysis *analysis = user_data;
+    gchar              *filename, *dirname;
+
+    mouse_settings_themes_analysis_set (analysis);
+
+    /* brackets can't be part of a group name */
+    if (strpbrk (analysis->path, "[]") == NULL)
+    {
+        g_key_file_set_integer (analysis_cache, analysis->path, "version", ANALYSIS_VERSION);
+        g_key_file_set_int64 (analysis_cache, analysis->path, "mtime", analysis->mtime);
+        g_key_file_set_integer (analysis_cache, analysis->path, "coverage", analysis->coverage);
+        g_key_file_set_integer (analysis_cache, analysis->path, "frames", analysis->frames);
+    }
+
+    mouse_settings_themes_analysis_free (analysis);
+
+    /* write the cache once, after the last theme */
+    if (--analysis_pending == 0)
+    {
+        filename = mouse_settings_themes_analysis_cache_file ();
+        dirname = g_path_get_dirname (filename);
+
+        if (g_mkdir_with_parents (dirname, 0700) == 0)
+            g_key_file_save_to_file (analysis_cache, filename, NULL);
+
+        g_free (dirname);
+        g_free (filename);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+mouse_settings_themes_analysis_run (gpointer data,
+                                    gpointer user_data)
+{
+    MouseThemeAnalysis *analysis = data;
+    XcursorFileToc     *toc;
+    GHashTable         *frames;
+    gchar              *filename;
+    guint               i, j, ntoc, n;
+    gint64              span;
+
+    alloc_accounting_worker_begin ();
+    span = TRACE_BEGIN ();
+
+    frames = g_hash_table_new (NULL, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (coverage_names); i++)
+    {
+        filename = g_build_filename (analysis->path, coverage_names[i], NULL);
+        toc = mouse_settings_themes_read_toc (filename, &ntoc);
+        g_free (filename);
+
+        if (toc == NULL)
+            continue;
+
+        analysis->coverage++;
+
+        /* frames of an animation share the nominal size */
+        g_hash_table_remove_all (frames);
+        for (j = 0; j < ntoc; j++)
+        {
+            if (toc[j].type != XCURSOR_IMAGE_TYPE)
+                continue;
+
+            n = GPOINTER_TO_UINT (g_hash_table_lookup (frames, GUINT_TO_POINTER (toc[j].subtype))) + 1;
+            g_hash_table_insert (frames, GUINT_TO_POINTER (toc[j].subtype), GUINT_TO_POINTER (n));
+            analysis->frames = MAX (analysis->frames, n);
+        }
+
+        g_free (toc);
+    }
+
+    g_hash_table_destroy (frames);
+
+    TRACE_END (span, "themes", "analyze", analysis->path);
+
+    g_idle_add (mouse_settings_themes_analysis_done, analysis);
+    alloc_accounting_worker_end ();
+}
+
+
+
+void
+mouse_settings_themes_analyze (GtkListStore *store)
+{
+    MouseThemeAnalysis *analysis;
+    GtkTreeModel       *model = GTK_TREE_MODEL (store);
+    GtkTreeIter         iter;
+    GtkTreePath        *tree_path;
+    gchar              *path, *filename;
+    gint64              mtime;
+    GStatBuf            st;
+
+    if (analysis_cache == NULL)
+    {
+        analysis_cache = g_key_file_new ();
+        filename = mouse_settings_themes_analysis_cache_file ();
+        g_key_file_load_from_file (analysis_cache, filename, G_KEY_FILE_NONE, NULL);
+        g_free (filename);
+    }
+
+    if (analysis_pool == NULL)
+        analysis_pool = g_thread_pool_new (mouse_settings_themes_analysis_run, NULL,
+                                           MIN (g_get_num_processors (), ANALYSIS_MAX_THREADS),
+                                           FALSE, NULL);
+
+    if (!gtk_tree_model_get_iter_first (model, &iter))
+        return;
+
+    do
+    {
+        gtk_tree_model_get (model, &iter, COLUMN_THEME_PATH, &path, -1);
+
+        /* the default theme has nothing to analyze */
+        if (path == NULL || g_stat (path, &st) != 0)
+        {
+            g_free (path);
+            continue;
+        }
+
+        mtime = st.st_mtime;
+
+        analysis = g_slice_new0 (MouseThemeAnalysis);
+        analysis->path = path;
+        analysis->mtime = mtime;
+
+        tree_path = gtk_tree_model_get_path (model, &iter);
+        analysis->row = gtk_tree_row_reference_new (model, tree_path);
+        gtk_tree_path_free (tree_path);
+
+        /* an unchanged theme directory keeps its last results */
+        if (strpbrk (path, "[]") == NULL && g_key_file_has_group (analysis_cache, path)
+            && g_key_file_get_integer (analysis_cache, path, "version", NULL) == ANALYSIS_VERSION
+            && g_key_file_get_int64 (analysis_cache, path, "mtime", NULL) == mtime)
+        {
+            analysis->coverage = g_key_file_get_integer (analysis_cache, path, "coverage", NULL);
+            analysis->frames = g_key_file_get_integer (analysis_cache, path, "frames", NULL);
+            mouse_settings_themes_analysis_set (analysis);
+            mouse_settings_themes_analysis_free (analysis);
+            continue;
+        }
+
+        analysis_pending++;
+        g_thread_pool_push (analysis_pool, analysis, NULL);
+    }
+    while (gtk_tree_model_iter_next (model, &iter));
+}
+
+
+
+void
+mouse_settings_themes_badge_cell_data_func (GtkCellLayout   *layout,
+                                            GtkCellRenderer *renderer,
+                                            GtkTreeModel    *model,
+                                            GtkTreeIter     *iter,
+                                            gpointer         user_data)
+{
+    GArray   *sizes;
+    GString  *badge;
+    gboolean  analyzed;
+    guint     coverage, frames, largest = 0;
+
+    gtk_tree_model_get (model, iter,
+                        COLUMN_THEME_SIZES, &sizes,
+                        COLUMN_THEME_COVERAGE, &coverage,
+                        COLUMN_THEME_FRAMES, &frames,
+                        COLUMN_THEME_ANALYZED, &analyzed, -1);
+
+    badge = g_string_new (NULL);
+
+    if (sizes != NULL && sizes->len > 0)
+        largest = g_array_index (sizes, guint, sizes->len - 1);
+    if (largest >= ANALYSIS_LARGE_SIZE)
+        g_string_append_printf (badge, _("hasta %u px"), largest);
+
+    if (analyzed && frames > 1)
+        g_string_append_printf (badge, "%s%s", badge->len ? " · " : "", _("animado"));
+
+    if (analyzed && coverage < G_N_ELEMENTS (coverage_names))
+        g_string_append_printf (badge, "%s%s", badge->len ? " · " : "", _("incompleto"));
+
+    g_object_set (renderer, "text", badge->str, NULL);
+
+    g_string_free (badge, TRUE);
+    if (sizes != NULL)
+        g_array_unref (sizes);
 }
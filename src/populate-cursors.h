@@ -19,15 +19,95 @@
 
 #include <gtk/gtk.h>
 
+/* shared catalog of the system cursor themes, see --build-system-cursor-catalog */
+#define CURSOR_CATALOG_FILE    "/var/cache/huayra-accessibility-settings/cursor-catalog"
+#define CURSOR_CATALOG_VERSION (1)
+
 enum
 {
-    COLUMN_THEME_PIXBUF,
     COLUMN_THEME_PATH,
     COLUMN_THEME_NAME,
     COLUMN_THEME_DISPLAY_NAME,
     COLUMN_THEME_COMMENT,
+    COLUMN_THEME_SIZES,
+    COLUMN_THEME_SEARCH_KEY,
+    COLUMN_THEME_COVERAGE,
+    COLUMN_THEME_FRAMES,
+    COLUMN_THEME_ANALYZED,
     N_THEME_COLUMNS
 };
 
 GtkListStore *
 mouse_settings_themes_populate_store (void);
+
+void
+mouse_settings_themes_populate_store_async (GCancellable        *cancellable,
+                                            GAsyncReadyCallback  callback,
+                                            gpointer             user_data);
+
+GtkListStore *
+mouse_settings_themes_populate_store_finish (GAsyncResult  *result,
+                                             GError       **error);
+
+gboolean
+mouse_settings_themes_build_catalog (const gchar  *filename,
+                                     GError      **error);
+
+gchar *
+mouse_settings_themes_search_fold (const gchar *text);
+
+GtkTreeModel *
+mouse_settings_themes_filter_new (GtkListStore *store);
+
+void
+mouse_settings_themes_filter_set_text (GtkTreeModelFilter *filter,
+                                       const gchar        *text);
+
+GdkPixbuf *
+mouse_settings_themes_load_cursor (const gchar *path,
+                                   const gchar *name,
+                                   guint        size);
+
+void
+mouse_settings_themes_animate_image (GtkImage    *image,
+                                     const gchar *path,
+                                     const gchar *name,
+                                     guint        size);
+
+guint
+mouse_settings_themes_nearest_size (GArray *sizes,
+                                    guint   size,
+                                    guint   min_size,
+                                    guint   max_size);
+
+void
+mouse_settings_themes_preview_cell_data_func (GtkCellLayout   *layout,
+                                              GtkCellRenderer *renderer,
+                                              GtkTreeModel    *model,
+                                              GtkTreeIter     *iter,
+                                              gpointer         user_data);
+
+void
+mouse_settings_themes_preview_image (GtkImage    *image,
+                                     const gchar *path);
+
+void
+mouse_settings_themes_warm_async (const gchar         *path,
+                                  guint                size,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data);
+
+gboolean
+mouse_settings_themes_warm_finish (GAsyncResult  *result,
+                                   GError       **error);
+
+void
+mouse_settings_themes_analyze (GtkListStore *store);
+
+void
+mouse_settings_themes_badge_cell_data_func (GtkCellLayout   *layout,
+                                            GtkCellRenderer *renderer,
+                                            GtkTreeModel    *model,
+                                            GtkTreeIter     *iter,
+                                            gpointer         user_data);
@@ -0,0 +1,192 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include "preview-cache.h"
+
+typedef struct {
+	gchar     *key;
+	GdkPixbuf *pixbuf;
+	gsize      bytes;
+	GList      link;
+} PreviewCacheEntry;
+
+static GHashTable *cache_table = NULL;
+static GQueue      cache_lru = G_QUEUE_INIT;
+static gsize       cache_bytes = 0;
+static gsize       cache_budget = PREVIEW_CACHE_DEFAULT_BUDGET;
+static GMutex      cache_lock;
+
+static gchar *
+preview_cache_key (const gchar *path,
+                   const gchar *name,
+                   guint        size)
+{
+	return g_strdup_printf ("%s/%s@%u", path, name, size);
+}
+
+static void
+preview_cache_entry_free (PreviewCacheEntry *entry)
+{
+	g_object_unref (entry->pixbuf);
+	g_free (entry->key);
+	g_slice_free (PreviewCacheEntry, entry);
+}
+
+/* Drop the entry from the LRU list and the table. */
+
+static void
+preview_cache_remove_entry (PreviewCacheEntry *entry)
+{
+	g_queue_unlink (&cache_lru, &entry->link);
+	cache_bytes -= entry->bytes;
+
+	g_hash_table_remove (cache_table, entry->key);
+}
+
+/* Evict the least recently used previews until @needed bytes fit. */
+
+static void
+preview_cache_evict (gsize needed)
+{
+	PreviewCacheEntry *entry;
+
+	while (cache_lru.tail != NULL && cache_bytes + needed > cache_budget) {
+		entry = cache_lru.tail->data;
+		preview_cache_remove_entry (entry);
+	}
+}
+
+void
+preview_cache_set_budget (gsize budget)
+{
+	g_mutex_lock (&cache_lock);
+	cache_budget = budget;
+	preview_cache_evict (0);
+	g_mutex_unlock (&cache_lock);
+}
+
+gsize
+preview_cache_get_budget (void)
+{
+	return cache_budget;
+}
+
+gsize
+preview_cache_get_size (void)
+{
+	gsize bytes;
+
+	g_mutex_lock (&cache_lock);
+	bytes = cache_bytes;
+	g_mutex_unlock (&cache_lock);
+
+	return bytes;
+}
+
+GdkPixbuf *
+preview_cache_lookup (const gchar *path,
+                      const gchar *name,
+                      guint        size)
+{
+	PreviewCacheEntry *entry = NULL;
+	GdkPixbuf *pixbuf = NULL;
+	gchar *key;
+
+	key = preview_cache_key (path, name, size);
+
+	g_mutex_lock (&cache_lock);
+
+	if (cache_table != NULL)
+		entry = g_hash_table_lookup (cache_table, key);
+
+	if (entry != NULL) {
+		/* Hot previews move to the front of the list. */
+		g_queue_unlink (&cache_lru, &entry->link);
+		g_queue_push_head_link (&cache_lru, &entry->link);
+
+		pixbuf = g_object_ref (entry->pixbuf);
+	}
+
+	g_mutex_unlock (&cache_lock);
+
+	g_free (key);
+
+	return pixbuf;
+}
+
+void
+preview_cache_insert (const gchar *path,
+                      const gchar *name,
+                      guint        size,
+                      GdkPixbuf   *pixbuf)
+{
+	PreviewCacheEntry *entry;
+	gchar *key;
+	gsize bytes;
+
+	g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+
+	g_mutex_lock (&cache_lock);
+
+	if (cache_table == NULL)
+		cache_table = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+		                                     (GDestroyNotify) preview_cache_entry_free);
+
+	key = preview_cache_key (path, name, size);
+
+	entry = g_hash_table_lookup (cache_table, key);
+	if (entry != NULL)
+		preview_cache_remove_entry (entry);
+
+	/* Never let a single preview flush the whole cache. */
+	bytes = gdk_pixbuf_get_byte_length (pixbuf);
+	if (bytes > cache_budget) {
+		g_mutex_unlock (&cache_lock);
+		g_free (key);
+		return;
+	}
+
+	preview_cache_evict (bytes);
+
+	entry = g_slice_new0 (PreviewCacheEntry);
+	entry->key = key;
+	entry->pixbuf = g_object_ref (pixbuf);
+	entry->bytes = bytes;
+	entry->link.data = entry;
+
+	g_queue_push_head_link (&cache_lru, &entry->link);
+	g_hash_table_insert (cache_table, entry->key, entry);
+	cache_bytes += bytes;
+
+	g_mutex_unlock (&cache_lock);
+}
+
+void
+preview_cache_clear (void)
+{
+	g_mutex_lock (&cache_lock);
+
+	if (cache_table != NULL) {
+		g_hash_table_destroy (cache_table);
+		cache_table = NULL;
+
+		g_queue_init (&cache_lru);
+		cache_bytes = 0;
+	}
+
+	g_mutex_unlock (&cache_lock);
+}
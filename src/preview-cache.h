@@ -0,0 +1,43 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef PREVIEW_CACHE_H
+#define PREVIEW_CACHE_H
+
+#include <gtk/gtk.h>
+
+/* Process-wide LRU cache of cursor previews, keyed by theme path, cursor
+ * name and pixel size. Every view that shows cursor previews shares it,
+ * and it may be filled from worker threads. */
+
+#define PREVIEW_CACHE_DEFAULT_BUDGET (2 * 1024 * 1024)
+
+void       preview_cache_set_budget (gsize        budget);
+gsize      preview_cache_get_budget (void);
+gsize      preview_cache_get_size   (void);
+
+GdkPixbuf *preview_cache_lookup     (const gchar *path,
+                                     const gchar *name,
+                                     guint        size);
+void       preview_cache_insert     (const gchar *path,
+                                     const gchar *name,
+                                     guint        size,
+                                     GdkPixbuf   *pixbuf);
+
+void       preview_cache_clear      (void);
+
+#endif /* PREVIEW_CACHE_H */
@@ -0,0 +1,148 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <stdlib.h>
+
+#include "a11y-settings.h"
+#include "settings-bench.h"
+#include "stats.h"
+
+typedef enum {
+	BENCH_HIGH_CONTRAST,
+	BENCH_LARGE_PRINT,
+	BENCH_RESET,
+	BENCH_SAVE_AT,
+	N_BENCH_ACTIONS
+} BenchAction;
+
+static const gchar *action_names[N_BENCH_ACTIONS] = {
+	"high-contrast",
+	"large-print",
+	"reset",
+	"save-at"
+};
+
+static guint64 notifications = 0;
+
+static void
+settings_bench_changed (GSettings   *settings,
+                        const gchar *key,
+                        gpointer     user_data)
+{
+	notifications++;
+}
+
+/* Each call flips the state, so every round really writes. */
+
+static void
+settings_bench_action (BenchAction action,
+                       gboolean    enable)
+{
+	switch (action) {
+		case BENCH_HIGH_CONTRAST:
+			a11y_option_set_boolean (A11Y_OPTION_HIGH_CONTRAST, enable);
+			break;
+		case BENCH_LARGE_PRINT:
+			a11y_option_set_boolean (A11Y_OPTION_LARGE_PRINT, enable);
+			break;
+		case BENCH_RESET:
+			if (enable)
+				a11y_option_set_boolean (A11Y_OPTION_HIGH_CONTRAST, TRUE);
+			else
+				a11y_settings_reset_user_changes ();
+			break;
+		case BENCH_SAVE_AT:
+			/* What Aceptar writes, without the logout prompt. */
+			a11y_option_set_boolean (A11Y_OPTION_SCREEN_READER, enable);
+			a11y_option_set_boolean (A11Y_OPTION_KEYBOARD, enable);
+			if (a11y_settings_get_accessibility () != enable)
+				a11y_settings_set_accessibility (enable);
+			break;
+		default:
+			g_return_if_reached ();
+	}
+
+	/* Deliver the change notifications queued by the writes. */
+	while (g_main_context_iteration (NULL, FALSE));
+}
+
+static gint
+settings_bench_compare (gconstpointer a,
+                        gconstpointer b)
+{
+	gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+	return (x > y) - (x < y);
+}
+
+int
+settings_bench_run (guint iterations)
+{
+	gint64 *latencies, begin;
+	guint64 writes, fired;
+	guint action, schema, i;
+
+	if (iterations == 0)
+		iterations = SETTINGS_BENCH_DEFAULT_ITERATIONS;
+
+	/* Must happen before the first GSettings is created. The schemas are
+	 * looked up as usual, GSETTINGS_SCHEMA_DIR can point to a local build. */
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+
+	stats_enable ();
+
+	for (schema = 0; schema < N_A11Y_SCHEMAS; schema++)
+		g_signal_connect (a11y_settings_get (schema), "changed",
+		                  G_CALLBACK (settings_bench_changed), NULL);
+
+	a11y_settings_snapshot ();
+
+	latencies = g_new (gint64, iterations);
+
+	g_print ("%-14s %10s %10s %10s %10s\n",
+	         "action", "p50 (us)", "p99 (us)", "writes/op", "notify/op");
+
+	for (action = 0; action < N_BENCH_ACTIONS; action++) {
+		writes = stats_get_settings_writes ();
+		fired = notifications;
+
+		for (i = 0; i < iterations; i++) {
+			begin = g_get_monotonic_time ();
+			settings_bench_action (action, i % 2 == 0);
+			latencies[i] = g_get_monotonic_time () - begin;
+		}
+
+		writes = stats_get_settings_writes () - writes;
+		fired = notifications - fired;
+
+		qsort (latencies, iterations, sizeof (gint64), settings_bench_compare);
+
+		g_print ("%-14s %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10.2f %10.2f\n",
+		         action_names[action],
+		         latencies[iterations / 2],
+		         latencies[(guint64) iterations * 99 / 100],
+		         (gdouble) writes / iterations,
+		         (gdouble) fired / iterations);
+
+		a11y_settings_reset_user_changes ();
+		while (g_main_context_iteration (NULL, FALSE));
+	}
+
+	g_free (latencies);
+
+	return EXIT_SUCCESS;
+}
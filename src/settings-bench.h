@@ -0,0 +1,30 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef SETTINGS_BENCH_H
+#define SETTINGS_BENCH_H
+
+#include <glib.h>
+
+/* Display-free latency benchmark of the settings paths, run against the
+ * in-memory GSettings backend. */
+
+#define SETTINGS_BENCH_DEFAULT_ITERATIONS 1000
+
+int settings_bench_run (guint iterations);
+
+#endif
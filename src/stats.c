@@ -0,0 +1,185 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <glib-unix.h>
+#include <signal.h>
+#include <stdio.h>
+
+#include "stats.h"
+
+gboolean stats_enabled = FALSE;
+
+static const gchar *counter_names[N_STATS_COUNTERS] = {
+	"dirs_opened",
+	"themes_found",
+	"files_scanned",
+	"files_decoded",
+	"bytes_decoded",
+	"pixbufs_alive",
+	"pixbuf_bytes_alive",
+	"dbus_calls",
+	"processes_spawned"
+};
+
+typedef struct {
+	guint64 reads;
+	guint64 writes;
+} StatsSettings;
+
+static gint64 counters[N_STATS_COUNTERS] = { 0, };
+static GHashTable *settings_counters = NULL;
+static GMutex stats_lock;
+
+static gboolean
+stats_signal_cb (gpointer user_data)
+{
+	stats_dump ();
+
+	return G_SOURCE_CONTINUE;
+}
+
+void
+stats_enable (void)
+{
+	if (stats_enabled)
+		return;
+
+	settings_counters = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                           NULL, g_free);
+	g_unix_signal_add (SIGUSR1, stats_signal_cb, NULL);
+
+	stats_enabled = TRUE;
+}
+
+void
+stats_add (StatsCounter counter,
+           gint64       n)
+{
+	g_mutex_lock (&stats_lock);
+	counters[counter] += n;
+	g_mutex_unlock (&stats_lock);
+}
+
+void
+stats_settings_access (const gchar *schema_id,
+                       gboolean     write)
+{
+	StatsSettings *entry;
+
+	g_mutex_lock (&stats_lock);
+
+	/* Schema ids are string constants, they outlive the table. */
+	entry = g_hash_table_lookup (settings_counters, schema_id);
+	if (entry == NULL) {
+		entry = g_new0 (StatsSettings, 1);
+		g_hash_table_insert (settings_counters, (gpointer) schema_id, entry);
+	}
+
+	if (write)
+		entry->writes++;
+	else
+		entry->reads++;
+
+	g_mutex_unlock (&stats_lock);
+}
+
+static void
+stats_pixbuf_finalized (gpointer  data,
+                        GObject  *where_the_object_was)
+{
+	g_mutex_lock (&stats_lock);
+	counters[STATS_PIXBUFS_ALIVE]--;
+	counters[STATS_PIXBUF_BYTES_ALIVE] -= GPOINTER_TO_SIZE (data);
+	g_mutex_unlock (&stats_lock);
+}
+
+void
+stats_track_pixbuf (GdkPixbuf *pixbuf)
+{
+	gsize bytes;
+
+	if (pixbuf == NULL)
+		return;
+
+	bytes = gdk_pixbuf_get_byte_length (pixbuf);
+
+	g_mutex_lock (&stats_lock);
+	counters[STATS_PIXBUFS_ALIVE]++;
+	counters[STATS_PIXBUF_BYTES_ALIVE] += bytes;
+	g_mutex_unlock (&stats_lock);
+
+	g_object_weak_ref (G_OBJECT (pixbuf), stats_pixbuf_finalized, GSIZE_TO_POINTER (bytes));
+}
+
+guint64
+stats_get_settings_writes (void)
+{
+	GHashTableIter iter;
+	StatsSettings *entry;
+	guint64 writes = 0;
+
+	if (!stats_enabled)
+		return 0;
+
+	g_mutex_lock (&stats_lock);
+	g_hash_table_iter_init (&iter, settings_counters);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+		writes += entry->writes;
+	g_mutex_unlock (&stats_lock);
+
+	return writes;
+}
+
+void
+stats_dump (void)
+{
+	GHashTableIter iter;
+	StatsSettings *entry;
+	const gchar *schema_id;
+	GString *json;
+	gboolean first = TRUE;
+	guint i;
+
+	if (!stats_enabled)
+		return;
+
+	json = g_string_new ("{");
+
+	g_mutex_lock (&stats_lock);
+
+	for (i = 0; i < N_STATS_COUNTERS; i++)
+		g_string_append_printf (json, "\"%s\":%" G_GINT64_FORMAT ",",
+		                        counter_names[i], counters[i]);
+
+	g_string_append (json, "\"settings\":{");
+	g_hash_table_iter_init (&iter, settings_counters);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &schema_id, (gpointer *) &entry)) {
+		g_string_append_printf (json, "%s\"%s\":{\"reads\":%" G_GUINT64_FORMAT
+		                        ",\"writes\":%" G_GUINT64_FORMAT "}",
+		                        first ? "" : ",", schema_id,
+		                        entry->reads, entry->writes);
+		first = FALSE;
+	}
+	g_string_append (json, "}}");
+
+	g_mutex_unlock (&stats_lock);
+
+	fprintf (stderr, "%s\n", json->str);
+	fflush (stderr);
+
+	g_string_free (json, TRUE);
+}
@@ -0,0 +1,75 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <gtk/gtk.h>
+
+/* Cumulative counters, dumped as JSON on stderr at exit and on SIGUSR1
+ * when the program runs with --stats. Disabled counters cost a flag test. */
+
+typedef enum {
+	STATS_DIRS_OPENED,
+	STATS_THEMES_FOUND,
+	STATS_FILES_SCANNED,
+	STATS_FILES_DECODED,
+	STATS_BYTES_DECODED,
+	STATS_PIXBUFS_ALIVE,
+	STATS_PIXBUF_BYTES_ALIVE,
+	STATS_DBUS_CALLS,
+	STATS_PROCESSES_SPAWNED,
+	N_STATS_COUNTERS
+} StatsCounter;
+
+extern gboolean stats_enabled;
+
+#define STATS_ADD(counter, n)                                            \
+	G_STMT_START {                                                   \
+		if (G_UNLIKELY (stats_enabled))                          \
+			stats_add (counter, n);                          \
+	} G_STMT_END
+
+#define STATS_SETTINGS_READ(schema_id)                                   \
+	G_STMT_START {                                                   \
+		if (G_UNLIKELY (stats_enabled))                          \
+			stats_settings_access (schema_id, FALSE);        \
+	} G_STMT_END
+
+#define STATS_SETTINGS_WRITE(schema_id)                                  \
+	G_STMT_START {                                                   \
+		if (G_UNLIKELY (stats_enabled))                          \
+			stats_settings_access (schema_id, TRUE);         \
+	} G_STMT_END
+
+#define STATS_TRACK_PIXBUF(pixbuf)                                       \
+	G_STMT_START {                                                   \
+		if (G_UNLIKELY (stats_enabled))                          \
+			stats_track_pixbuf (pixbuf);                     \
+	} G_STMT_END
+
+void stats_enable          (void);
+void stats_add             (StatsCounter  counter,
+                            gint64        n);
+void stats_settings_access (const gchar  *schema_id,
+                            gboolean      write);
+void stats_track_pixbuf    (GdkPixbuf    *pixbuf);
+
+guint64 stats_get_settings_writes (void);
+void stats_dump            (void);
+
+#endif
@@ -0,0 +1,159 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+gboolean trace_enabled = FALSE;
+
+typedef struct {
+	const gchar *category;
+	const gchar *name;
+	gchar       *detail;
+	gint64       begin;
+	gint64       duration;
+	guint        thread;
+} TraceSpan;
+
+static gchar *trace_filename = NULL;
+static gint64 trace_origin = 0;
+static GArray *trace_spans = NULL;
+static GMutex trace_lock;
+static GPrivate trace_thread;
+static guint trace_threads = 0;
+
+void
+trace_init (void)
+{
+	const gchar *filename;
+
+	filename = g_getenv (TRACE_ENV);
+	if (filename == NULL || *filename == '\0')
+		return;
+
+	trace_filename = g_strdup (filename);
+	trace_origin = g_get_monotonic_time ();
+	trace_spans = g_array_new (FALSE, FALSE, sizeof (TraceSpan));
+	trace_enabled = TRUE;
+}
+
+void
+trace_add_span (gint64       begin,
+                const gchar *category,
+                const gchar *name,
+                const gchar *detail)
+{
+	TraceSpan span;
+	gint64 end;
+
+	end = g_get_monotonic_time ();
+
+	g_mutex_lock (&trace_lock);
+
+	/* Small stable ids read better in the viewer than pthread_t values. */
+	span.thread = GPOINTER_TO_UINT (g_private_get (&trace_thread));
+	if (span.thread == 0) {
+		span.thread = ++trace_threads;
+		g_private_set (&trace_thread, GUINT_TO_POINTER (span.thread));
+	}
+
+	span.category = category;
+	span.name = name;
+	span.detail = g_strdup (detail);
+	span.begin = begin;
+	span.duration = end - begin;
+
+	if (trace_spans)
+		g_array_append_val (trace_spans, span);
+	else
+		g_free (span.detail);
+
+	g_mutex_unlock (&trace_lock);
+}
+
+static void
+trace_write_string (FILE        *file,
+                    const gchar *str)
+{
+	const gchar *p;
+
+	fputc ('"', file);
+	for (p = str; *p; p++) {
+		if (*p == '"' || *p == '\\')
+			fprintf (file, "\\%c", *p);
+		else if ((guchar) *p < 0x20)
+			fprintf (file, "\\u%04x", (guchar) *p);
+		else
+			fputc (*p, file);
+	}
+	fputc ('"', file);
+}
+
+void
+trace_shutdown (void)
+{
+	TraceSpan *span;
+	FILE *file;
+	guint i;
+
+	if (!trace_enabled)
+		return;
+
+	g_mutex_lock (&trace_lock);
+
+	trace_enabled = FALSE;
+
+	file = fopen (trace_filename, "w");
+	if (file == NULL) {
+		g_warning ("Can't write trace to %s", trace_filename);
+	}
+	else {
+		fputs ("{\"traceEvents\":[\n", file);
+		for (i = 0; i < trace_spans->len; i++) {
+			span = &g_array_index (trace_spans, TraceSpan, i);
+
+			fputs ("{\"ph\":\"X\",\"name\":", file);
+			trace_write_string (file, span->name);
+			fputs (",\"cat\":", file);
+			trace_write_string (file, span->category);
+			fprintf (file, ",\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT
+			         ",\"pid\":%d,\"tid\":%u",
+			         span->begin - trace_origin, span->duration,
+			         (gint) getpid (), span->thread);
+			if (span->detail) {
+				fputs (",\"args\":{\"detail\":", file);
+				trace_write_string (file, span->detail);
+				fputc ('}', file);
+			}
+			fputs (i + 1 < trace_spans->len ? "},\n" : "}\n", file);
+		}
+		fputs ("]}\n", file);
+		fclose (file);
+	}
+
+	for (i = 0; i < trace_spans->len; i++)
+		g_free (g_array_index (trace_spans, TraceSpan, i).detail);
+	g_array_free (trace_spans, TRUE);
+	trace_spans = NULL;
+
+	g_free (trace_filename);
+	trace_filename = NULL;
+
+	g_mutex_unlock (&trace_lock);
+}
@@ -0,0 +1,46 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <glib.h>
+
+/* Timing spans written as a Chrome trace JSON file (chrome://tracing,
+ * Perfetto). Enabled when HUAYRA_A11Y_TRACE names the output file; while
+ * disabled a span costs a flag test. */
+
+#define TRACE_ENV "HUAYRA_A11Y_TRACE"
+
+extern gboolean trace_enabled;
+
+#define TRACE_BEGIN() (G_UNLIKELY (trace_enabled) ? g_get_monotonic_time () : 0)
+
+#define TRACE_END(begin, category, name, detail)                         \
+	G_STMT_START {                                                   \
+		if (G_UNLIKELY (begin))                                  \
+			trace_add_span (begin, category, name, detail);  \
+	} G_STMT_END
+
+void trace_init     (void);
+void trace_add_span (gint64       begin,
+                     const gchar *category,
+                     const gchar *name,
+                     const gchar *detail);
+void trace_shutdown (void);
+
+#endif
@@ -0,0 +1,158 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#include <string.h>
+
+#include "stats.h"
+#include "trace.h"
+#include "wiki-probe.h"
+
+typedef struct {
+	GSocketConnection *connection;
+	GDataInputStream  *input;
+	gchar             *request;
+	guint              timeout_id;
+	gint64             span;
+} WikiProbe;
+
+static WikiReachability state = WIKI_UNKNOWN;
+static GCancellable *cancellable = NULL;
+
+static void
+wiki_probe_finish (WikiProbe *probe,
+                   gboolean   reachable)
+{
+	state = reachable ? WIKI_REACHABLE : WIKI_UNREACHABLE;
+
+	TRACE_END (probe->span, "help", "wiki probe", reachable ? "reachable" : "unreachable");
+
+	if (probe->timeout_id)
+		g_source_remove (probe->timeout_id);
+
+	g_clear_object (&probe->input);
+	g_clear_object (&probe->connection);
+	g_clear_object (&cancellable);
+	g_free (probe->request);
+	g_slice_free (WikiProbe, probe);
+}
+
+static gboolean
+wiki_probe_timeout (gpointer user_data)
+{
+	WikiProbe *probe = user_data;
+
+	/* The pending operation completes as cancelled and finishes the probe. */
+	probe->timeout_id = 0;
+	g_cancellable_cancel (cancellable);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+wiki_probe_status_read (GObject      *source,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+	WikiProbe *probe = user_data;
+	gchar *line;
+	guint status = 0;
+
+	/* Any final answer of the server, redirects included, is a working wiki;
+	 * filtering proxies answer with 403 or their own error pages. */
+	line = g_data_input_stream_read_line_finish (G_DATA_INPUT_STREAM (source), result, NULL, NULL);
+	if (line && g_str_has_prefix (line, "HTTP/") && strchr (line, ' '))
+		status = g_ascii_strtoull (strchr (line, ' ') + 1, NULL, 10);
+	g_free (line);
+
+	wiki_probe_finish (probe, status >= 200 && status < 400);
+}
+
+static void
+wiki_probe_request_written (GObject      *source,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	WikiProbe *probe = user_data;
+
+	if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (source), result, NULL, NULL)) {
+		wiki_probe_finish (probe, FALSE);
+		return;
+	}
+
+	probe->input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (probe->connection)));
+	g_data_input_stream_read_line_async (probe->input, G_PRIORITY_LOW, cancellable,
+	                                     wiki_probe_status_read, probe);
+}
+
+static void
+wiki_probe_connected (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	WikiProbe *probe = user_data;
+	GOutputStream *output;
+
+	probe->connection = g_socket_client_connect_to_uri_finish (G_SOCKET_CLIENT (source), result, NULL);
+	if (probe->connection == NULL) {
+		wiki_probe_finish (probe, FALSE);
+		return;
+	}
+
+	output = g_io_stream_get_output_stream (G_IO_STREAM (probe->connection));
+	g_output_stream_write_all_async (output, probe->request, strlen (probe->request),
+	                                 G_PRIORITY_LOW, cancellable,
+	                                 wiki_probe_request_written, probe);
+}
+
+void
+wiki_probe_start (void)
+{
+	GSocketClient *client;
+	WikiProbe *probe;
+	gchar *host = NULL, *path = NULL;
+
+	if (state != WIKI_UNKNOWN)
+		return;
+
+	if (!g_uri_split (WIKI_URL, G_URI_FLAGS_NONE, NULL, NULL, &host, NULL, &path, NULL, NULL, NULL)) {
+		state = WIKI_UNREACHABLE;
+		return;
+	}
+
+	state = WIKI_PROBING;
+
+	probe = g_slice_new0 (WikiProbe);
+	probe->span = TRACE_BEGIN ();
+	probe->request = g_strdup_printf ("HEAD %s HTTP/1.0\r\nHost: %s\r\n\r\n", path, host);
+
+	cancellable = g_cancellable_new ();
+	probe->timeout_id = g_timeout_add (WIKI_PROBE_TIMEOUT, wiki_probe_timeout, probe);
+
+	client = g_socket_client_new ();
+	g_socket_client_connect_to_uri_async (client, WIKI_URL, 80, cancellable,
+	                                      wiki_probe_connected, probe);
+	g_object_unref (client);
+
+	g_free (host);
+	g_free (path);
+}
+
+WikiReachability
+wiki_probe_get_state (void)
+{
+	return state;
+}
@@ -0,0 +1,42 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef WIKI_PROBE_H
+#define WIKI_PROBE_H
+
+#include <gio/gio.h>
+
+/* Whether the online help answers, probed once per session in the
+ * background. A route to the internet is not enough on filtered networks,
+ * so the probe asks the wiki itself for the page. */
+
+#define WIKI_URL "http://wiki.huayra.conectarigualdad.gob.ar/index.php/Accesibilidad"
+
+/* Milliseconds the probe may take before the wiki counts as unreachable. */
+#define WIKI_PROBE_TIMEOUT 2000
+
+typedef enum {
+	WIKI_UNKNOWN,
+	WIKI_PROBING,
+	WIKI_REACHABLE,
+	WIKI_UNREACHABLE
+} WikiReachability;
+
+void             wiki_probe_start     (void);
+WikiReachability wiki_probe_get_state (void);
+
+#endif
@@ -0,0 +1,165 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/* Stand-in for the accessibility bus launcher on a private session bus.
+ * org.a11y.Status.IsEnabled is set through org.freedesktop.DBus.Properties
+ * like on the real launcher, or refused; the harness changes the behaviour
+ * between cases through the control interface:
+ *
+ *   fake-a11y-bus [--fail]
+ */
+
+#include <stdlib.h>
+#include <gio/gio.h>
+
+#define A11Y_BUS_NAME      "org.a11y.Bus"
+#define A11Y_BUS_PATH      "/org/a11y/bus"
+
+static const gchar introspection_xml[] =
+	"<node>"
+	"  <interface name='org.a11y.Status'>"
+	"    <property type='b' name='IsEnabled' access='readwrite'/>"
+	"  </interface>"
+	"  <interface name='org.huayra.Test.FakeA11yBus'>"
+	"    <method name='SetBehaviour'>"
+	"      <arg type='b' name='fail' direction='in'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+static gboolean is_enabled = FALSE;
+static gboolean fail = FALSE;
+static GMainLoop *loop = NULL;
+
+static GOptionEntry entries[] = {
+	{ "fail", 0, 0, G_OPTION_ARG_NONE, &fail, "Refuse to set IsEnabled", NULL },
+	{ NULL }
+};
+
+static void
+method_call (GDBusConnection       *connection,
+             const gchar           *sender,
+             const gchar           *object_path,
+             const gchar           *interface_name,
+             const gchar           *method_name,
+             GVariant              *parameters,
+             GDBusMethodInvocation *invocation,
+             gpointer               user_data)
+{
+	if (g_strcmp0 (method_name, "SetBehaviour") == 0) {
+		g_variant_get (parameters, "(b)", &fail);
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	}
+}
+
+static GVariant *
+get_property (GDBusConnection  *connection,
+              const gchar      *sender,
+              const gchar      *object_path,
+              const gchar      *interface_name,
+              const gchar      *property_name,
+              GError          **error,
+              gpointer          user_data)
+{
+	return g_variant_new_boolean (is_enabled);
+}
+
+static gboolean
+set_property (GDBusConnection  *connection,
+              const gchar      *sender,
+              const gchar      *object_path,
+              const gchar      *interface_name,
+              const gchar      *property_name,
+              GVariant         *value,
+              GError          **error,
+              gpointer          user_data)
+{
+	if (fail) {
+		g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_ACCESS_DENIED,
+		             "IsEnabled refused by the fake accessibility bus");
+		return FALSE;
+	}
+
+	is_enabled = g_variant_get_boolean (value);
+
+	return TRUE;
+}
+
+static const GDBusInterfaceVTable vtable = {
+	method_call, get_property, set_property
+};
+
+static void
+bus_acquired (GDBusConnection *connection,
+              const gchar     *name,
+              gpointer         user_data)
+{
+	GDBusNodeInfo *info = user_data;
+	guint i;
+
+	for (i = 0; info->interfaces[i] != NULL; i++)
+		g_dbus_connection_register_object (connection, A11Y_BUS_PATH,
+		                                   info->interfaces[i], &vtable,
+		                                   NULL, NULL, NULL);
+}
+
+static void
+name_lost (GDBusConnection *connection,
+           const gchar     *name,
+           gpointer         user_data)
+{
+	g_printerr ("fake-a11y-bus: can't own %s\n", name);
+	g_main_loop_quit (loop);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	GOptionContext *context;
+	GDBusNodeInfo *info;
+	GError *error = NULL;
+	guint owner_id;
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	info = g_dbus_node_info_new_for_xml (introspection_xml, NULL);
+	loop = g_main_loop_new (NULL, FALSE);
+
+	/* Objects are exported before the name is owned, so a client that
+	 * sees the name never calls into nothing. */
+	owner_id = g_bus_own_name (G_BUS_TYPE_SESSION, A11Y_BUS_NAME,
+	                           G_BUS_NAME_OWNER_FLAGS_NONE,
+	                           bus_acquired, NULL, name_lost,
+	                           info, NULL);
+
+	g_main_loop_run (loop);
+
+	g_bus_unown_name (owner_id);
+	g_main_loop_unref (loop);
+	g_dbus_node_info_unref (info);
+
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,157 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/* Stand-in for org.mate.SessionManager on a private session bus. Logout
+ * answers after a configurable delay, or fails; the harness changes the
+ * behaviour between cases through the control interface:
+ *
+ *   fake-session-manager [--delay MS] [--fail]
+ */
+
+#include <stdlib.h>
+#include <gio/gio.h>
+
+#define GSM_SERVICE_DBUS   "org.mate.SessionManager"
+#define GSM_PATH_DBUS      "/org/mate/SessionManager"
+#define FAKE_ERROR_NAME    "org.mate.SessionManager.Error.Failed"
+
+static const gchar introspection_xml[] =
+	"<node>"
+	"  <interface name='org.mate.SessionManager'>"
+	"    <method name='Logout'>"
+	"      <arg type='u' name='mode' direction='in'/>"
+	"    </method>"
+	"  </interface>"
+	"  <interface name='org.huayra.Test.FakeSessionManager'>"
+	"    <method name='SetBehaviour'>"
+	"      <arg type='u' name='delay' direction='in'/>"
+	"      <arg type='b' name='fail' direction='in'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+static gint delay = 0;
+static gboolean fail = FALSE;
+static GMainLoop *loop = NULL;
+
+static GOptionEntry entries[] = {
+	{ "delay", 0, 0, G_OPTION_ARG_INT, &delay, "Answer Logout after MS milliseconds", "MS" },
+	{ "fail", 0, 0, G_OPTION_ARG_NONE, &fail, "Answer Logout with an error", NULL },
+	{ NULL }
+};
+
+static gboolean
+logout_answer (gpointer user_data)
+{
+	GDBusMethodInvocation *invocation = user_data;
+
+	if (fail)
+		g_dbus_method_invocation_return_dbus_error (invocation, FAKE_ERROR_NAME,
+		                                            "Logout refused by the fake session manager");
+	else
+		g_dbus_method_invocation_return_value (invocation, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+method_call (GDBusConnection       *connection,
+             const gchar           *sender,
+             const gchar           *object_path,
+             const gchar           *interface_name,
+             const gchar           *method_name,
+             GVariant              *parameters,
+             GDBusMethodInvocation *invocation,
+             gpointer               user_data)
+{
+	guint32 new_delay;
+
+	if (g_strcmp0 (method_name, "Logout") == 0) {
+		/* Answered from the main loop, like a busy session manager. */
+		g_timeout_add (delay, logout_answer, invocation);
+	}
+	else if (g_strcmp0 (method_name, "SetBehaviour") == 0) {
+		g_variant_get (parameters, "(ub)", &new_delay, &fail);
+		delay = new_delay;
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	}
+}
+
+static const GDBusInterfaceVTable vtable = {
+	method_call, NULL, NULL
+};
+
+static void
+bus_acquired (GDBusConnection *connection,
+              const gchar     *name,
+              gpointer         user_data)
+{
+	GDBusNodeInfo *info = user_data;
+	guint i;
+
+	for (i = 0; info->interfaces[i] != NULL; i++)
+		g_dbus_connection_register_object (connection, GSM_PATH_DBUS,
+		                                   info->interfaces[i], &vtable,
+		                                   NULL, NULL, NULL);
+}
+
+static void
+name_lost (GDBusConnection *connection,
+           const gchar     *name,
+           gpointer         user_data)
+{
+	g_printerr ("fake-session-manager: can't own %s\n", name);
+	g_main_loop_quit (loop);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	GOptionContext *context;
+	GDBusNodeInfo *info;
+	GError *error = NULL;
+	guint owner_id;
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	info = g_dbus_node_info_new_for_xml (introspection_xml, NULL);
+	loop = g_main_loop_new (NULL, FALSE);
+
+	/* Objects are exported before the name is owned, so a client that
+	 * sees the name never calls into nothing. */
+	owner_id = g_bus_own_name (G_BUS_TYPE_SESSION, GSM_SERVICE_DBUS,
+	                           G_BUS_NAME_OWNER_FLAGS_NONE,
+	                           bus_acquired, NULL, name_lost,
+	                           info, NULL);
+
+	g_main_loop_run (loop);
+
+	g_bus_unown_name (owner_id);
+	g_main_loop_unref (loop);
+	g_dbus_node_info_unref (info);
+
+	return EXIT_FAILURE;
+}
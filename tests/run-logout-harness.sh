@@ -0,0 +1,11 @@
+#!/bin/sh
+#
+# Runs test-logout on a private session bus, so the fake session manager
+# never meets the real one. Exit status 77 tells automake to skip.
+
+if ! command -v dbus-run-session >/dev/null 2>&1; then
+	echo "dbus-run-session is required" >&2
+	exit 77
+fi
+
+exec dbus-run-session -- "${G_TEST_BUILDDIR:-.}/test-logout" "$@"
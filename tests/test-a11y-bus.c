@@ -0,0 +1,243 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/* Drives a11y_bus_set_enabled() and a11y_bus_set_enabled_sync() against
+ * fake-a11y-bus on a private session bus (see run-a11y-bus-harness.sh):
+ * checks that IsEnabled reaches the launcher, and that a refused Set comes
+ * back as an error, which is what makes the dialog suggest a logout
+ * instead of starting the helpers. */
+
+#include <gio/gio.h>
+
+#include "a11y-bus.h"
+
+#define FAKE_INTERFACE_DBUS "org.huayra.Test.FakeA11yBus"
+
+typedef struct {
+	GMainLoop *loop;
+	gboolean   result;
+	GError    *error;
+} SetRun;
+
+static GSubprocess *fake = NULL;
+static GDBusConnection *bus = NULL;
+
+static void
+fake_set_behaviour (gboolean fail)
+{
+	GVariant *reply;
+	GError *error = NULL;
+
+	reply = g_dbus_connection_call_sync (bus, A11Y_BUS_NAME, A11Y_BUS_PATH,
+	                                     FAKE_INTERFACE_DBUS, "SetBehaviour",
+	                                     g_variant_new ("(b)", fail),
+	                                     NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+	                                     NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (reply);
+}
+
+static gboolean
+fake_is_enabled (void)
+{
+	GVariant *reply, *value;
+	GError *error = NULL;
+	gboolean enabled;
+
+	reply = g_dbus_connection_call_sync (bus, A11Y_BUS_NAME, A11Y_BUS_PATH,
+	                                     "org.freedesktop.DBus.Properties", "Get",
+	                                     g_variant_new ("(ss)", A11Y_STATUS_IFACE, "IsEnabled"),
+	                                     G_VARIANT_TYPE ("(v)"),
+	                                     G_DBUS_CALL_FLAGS_NONE, -1,
+	                                     NULL, &error);
+	g_assert_no_error (error);
+	g_variant_get (reply, "(v)", &value);
+	enabled = g_variant_get_boolean (value);
+	g_variant_unref (value);
+	g_variant_unref (reply);
+
+	return enabled;
+}
+
+static void
+set_done (GObject      *source,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+	SetRun *run = user_data;
+
+	run->result = a11y_bus_set_enabled_finish (result, &run->error);
+	g_main_loop_quit (run->loop);
+}
+
+static void
+set_run (SetRun   *run,
+         gboolean  enabled)
+{
+	run->loop = g_main_loop_new (NULL, FALSE);
+	a11y_bus_set_enabled (enabled, NULL, set_done, run);
+	g_main_loop_run (run->loop);
+	g_main_loop_unref (run->loop);
+}
+
+static void
+assert_refused (GError *error)
+{
+	gchar *remote;
+
+	g_assert_nonnull (error);
+	remote = g_dbus_error_get_remote_error (error);
+	g_assert_cmpstr (remote, ==, "org.freedesktop.DBus.Error.AccessDenied");
+	g_free (remote);
+}
+
+static void
+test_a11y_bus_enable (void)
+{
+	SetRun run = { 0 };
+
+	fake_set_behaviour (FALSE);
+	set_run (&run, TRUE);
+
+	g_assert_no_error (run.error);
+	g_assert_true (run.result);
+	g_assert_true (fake_is_enabled ());
+
+	set_run (&run, FALSE);
+
+	g_assert_no_error (run.error);
+	g_assert_true (run.result);
+	g_assert_false (fake_is_enabled ());
+}
+
+static void
+test_a11y_bus_enable_sync (void)
+{
+	GError *error = NULL;
+
+	fake_set_behaviour (FALSE);
+
+	g_assert_true (a11y_bus_set_enabled_sync (TRUE, &error));
+	g_assert_no_error (error);
+	g_assert_true (fake_is_enabled ());
+
+	g_assert_true (a11y_bus_set_enabled_sync (FALSE, &error));
+	g_assert_no_error (error);
+	g_assert_false (fake_is_enabled ());
+}
+
+static void
+test_a11y_bus_refused (void)
+{
+	SetRun run = { 0 };
+
+	fake_set_behaviour (TRUE);
+	set_run (&run, TRUE);
+
+	/* at_hot_enable_done() suggests a logout on this answer. */
+	g_assert_false (run.result);
+	assert_refused (run.error);
+	g_error_free (run.error);
+	g_assert_false (fake_is_enabled ());
+}
+
+static void
+test_a11y_bus_refused_sync (void)
+{
+	GError *error = NULL;
+
+	fake_set_behaviour (TRUE);
+
+	g_assert_false (a11y_bus_set_enabled_sync (TRUE, &error));
+	assert_refused (error);
+	g_error_free (error);
+	g_assert_false (fake_is_enabled ());
+}
+
+static void
+fake_appeared (GDBusConnection *connection,
+               const gchar     *name,
+               const gchar     *name_owner,
+               gpointer         user_data)
+{
+	g_main_loop_quit (user_data);
+}
+
+static gboolean
+fake_start_timeout (gpointer user_data)
+{
+	g_error ("fake-a11y-bus did not appear on the bus");
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fake_start (void)
+{
+	GMainLoop *loop;
+	GError *error = NULL;
+	gchar *program;
+	guint watch_id, timeout_id;
+
+	bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+
+	program = g_test_build_filename (G_TEST_BUILT, "fake-a11y-bus", NULL);
+	fake = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, &error, program, NULL);
+	g_assert_no_error (error);
+	g_free (program);
+
+	loop = g_main_loop_new (NULL, FALSE);
+	watch_id = g_bus_watch_name_on_connection (bus, A11Y_BUS_NAME,
+	                                           G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                                           fake_appeared, NULL, loop, NULL);
+	timeout_id = g_timeout_add_seconds (10, fake_start_timeout, NULL);
+	g_main_loop_run (loop);
+	g_source_remove (timeout_id);
+	g_bus_unwatch_name (watch_id);
+	g_main_loop_unref (loop);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	int status;
+
+	g_test_init (&argc, &argv, NULL);
+
+	/* Never talk to the accessibility bus of the desktop. */
+	if (g_getenv ("DBUS_SESSION_BUS_ADDRESS") == NULL) {
+		g_printerr ("no private session bus, run under run-a11y-bus-harness.sh\n");
+		return 77;
+	}
+
+	fake_start ();
+
+	g_test_add_func ("/a11y-bus/enable", test_a11y_bus_enable);
+	g_test_add_func ("/a11y-bus/enable-sync", test_a11y_bus_enable_sync);
+	g_test_add_func ("/a11y-bus/refused", test_a11y_bus_refused);
+	g_test_add_func ("/a11y-bus/refused-sync", test_a11y_bus_refused_sync);
+
+	status = g_test_run ();
+
+	g_subprocess_force_exit (fake);
+	g_object_unref (fake);
+	g_object_unref (bus);
+
+	return status;
+}
@@ -0,0 +1,331 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/* Repeated invocations of accounted handlers: a handler that keeps its
+ * allocations is reported, one that frees them is not, and handlers that
+ * run while a worker is busy or a cache fills are left alone. The option
+ * writes and the theme lookup of the dialog handlers go through the same
+ * guards, on the memory settings backend, and must come out clean. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+
+#include "a11y-settings.h"
+#include "alloc-accounting.h"
+#include "populate-cursors.h"
+
+/* Comfortably more than the streak that makes a leak. */
+#define EMISSIONS 32
+#define CHUNK     4096
+
+typedef struct { GObject parent; } TestEmitter;
+typedef struct { GObjectClass parent_class; } TestEmitterClass;
+
+static GType test_emitter_get_type (void);
+G_DEFINE_TYPE (TestEmitter, test_emitter, G_TYPE_OBJECT)
+
+static void
+test_emitter_class_init (TestEmitterClass *klass)
+{
+	g_signal_new ("poke", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST,
+	              0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+}
+
+static void
+test_emitter_init (TestEmitter *emitter)
+{
+}
+
+static GPtrArray *kept = NULL;
+static gsize cache_bytes = 0;
+
+static gsize
+test_cache_size (void)
+{
+	return cache_bytes;
+}
+
+static void
+leaky_handler (GObject *emitter, gpointer data)
+{
+	g_ptr_array_add (kept, g_malloc (CHUNK));
+}
+
+static void
+clean_handler (GObject *emitter, gpointer data)
+{
+	g_free (g_malloc (CHUNK));
+}
+
+static void
+cache_handler (GObject *emitter, gpointer data)
+{
+	g_ptr_array_add (kept, g_malloc (CHUNK));
+	cache_bytes += CHUNK;
+}
+
+static void
+poke (GObject *emitter)
+{
+	guint i;
+
+	for (i = 0; i < EMISSIONS; i++)
+		g_signal_emit_by_name (emitter, "poke");
+}
+
+static void
+test_leak_reported (void)
+{
+	GObject *emitter;
+
+	if (g_test_subprocess ()) {
+		emitter = g_object_new (test_emitter_get_type (), NULL);
+		ACCOUNTED_SIGNAL_CONNECT (emitter, "poke", leaky_handler, NULL);
+		poke (emitter);
+		g_object_unref (emitter);
+		return;
+	}
+
+	g_test_trap_subprocess (NULL, 0, 0);
+	g_test_trap_assert_failed ();
+	g_test_trap_assert_stderr ("*leaky_handler leaked in 8 calls in a row*");
+}
+
+static void
+test_clean_quiet (void)
+{
+	GObject *emitter;
+
+	/* Criticals are fatal here, a false positive aborts the test. */
+	emitter = g_object_new (test_emitter_get_type (), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (emitter, "poke", clean_handler, NULL);
+	poke (emitter);
+	g_object_unref (emitter);
+}
+
+static gboolean worker_started = FALSE;
+static gboolean worker_stop = FALSE;
+static GMutex worker_lock;
+static GCond worker_cond;
+
+static gpointer
+worker_thread (gpointer data)
+{
+	alloc_accounting_worker_begin ();
+
+	g_mutex_lock (&worker_lock);
+	worker_started = TRUE;
+	g_cond_broadcast (&worker_cond);
+	while (!worker_stop)
+		g_cond_wait (&worker_cond, &worker_lock);
+	g_mutex_unlock (&worker_lock);
+
+	alloc_accounting_worker_end ();
+
+	return NULL;
+}
+
+static void
+test_busy_worker_skipped (void)
+{
+	GObject *emitter;
+	GThread *thread;
+
+	thread = g_thread_new ("worker", worker_thread, NULL);
+
+	g_mutex_lock (&worker_lock);
+	while (!worker_started)
+		g_cond_wait (&worker_cond, &worker_lock);
+	g_mutex_unlock (&worker_lock);
+
+	/* The heap is shared with the worker, nothing can be blamed. */
+	emitter = g_object_new (test_emitter_get_type (), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (emitter, "poke", leaky_handler, NULL);
+	poke (emitter);
+	g_object_unref (emitter);
+
+	g_mutex_lock (&worker_lock);
+	worker_stop = TRUE;
+	g_cond_broadcast (&worker_cond);
+	g_mutex_unlock (&worker_lock);
+
+	g_thread_join (thread);
+}
+
+/* What large_print_checkbutton_toggled and the high contrast check button
+ * end up writing when the dialog commits, flipped on every call. */
+
+static void
+option_toggle_handler (GObject *emitter, gpointer data)
+{
+	static gboolean enable = FALSE;
+
+	enable = !enable;
+	a11y_option_set_boolean (A11Y_OPTION_HIGH_CONTRAST, enable);
+	a11y_settings_set_large_print_factor (enable ? DPI_FACTOR_LARGER : 1.0);
+
+	/* Deliver the change notifications queued by the writes. */
+	while (g_main_context_iteration (NULL, FALSE));
+}
+
+/* What icon_cursor_theme_changed commits and what
+ * cursor_combo_box_select_current_theme reads back, against the real
+ * theme store behind a typeahead filter. */
+
+static void
+theme_select_handler (GObject *emitter, gpointer data)
+{
+	static gboolean searching = FALSE;
+	GtkTreeModel *filter = data;
+	GtkTreeIter iter;
+	gchar *theme, *value;
+	gboolean found = FALSE;
+
+	searching = !searching;
+	mouse_settings_themes_filter_set_text (GTK_TREE_MODEL_FILTER (filter),
+	                                       searching ? "def" : NULL);
+
+	a11y_option_apply (A11Y_OPTION_CURSOR_THEME,
+	                   g_variant_new_string (searching ? "default" : "DMZ-White"));
+	while (g_main_context_iteration (NULL, FALSE));
+
+	theme = g_settings_get_string (a11y_settings_get (A11Y_SCHEMA_MOUSE), KEY_CURSOR_THEME);
+
+	if (gtk_tree_model_get_iter_first (filter, &iter)) {
+		do {
+			gtk_tree_model_get (filter, &iter, COLUMN_THEME_NAME, &value, -1);
+			found = !g_ascii_strcasecmp (value, theme);
+			g_free (value);
+		} while (!found && gtk_tree_model_iter_next (filter, &iter));
+	}
+
+	g_free (theme);
+}
+
+static gboolean
+settings_schemas_installed (void)
+{
+	static const gchar *schema_ids[] = {
+		INTERFACE_SCHEMA, MARCO_SCHEMA, FONT_RENDER_SCHEMA,
+		MOUSE_SCHEMA, VISUAL_SCHEMA, MOBILITY_SCHEMA
+	};
+	GSettingsSchemaSource *source;
+	GSettingsSchema *schema;
+	guint i;
+
+	source = g_settings_schema_source_get_default ();
+	for (i = 0; i < G_N_ELEMENTS (schema_ids); i++) {
+		schema = source ? g_settings_schema_source_lookup (source, schema_ids[i], TRUE) : NULL;
+		if (schema == NULL)
+			return FALSE;
+		g_settings_schema_unref (schema);
+	}
+
+	return TRUE;
+}
+
+static void
+test_option_paths_clean (void)
+{
+	GObject *emitter;
+
+	if (!settings_schemas_installed ()) {
+		g_test_skip ("the MATE settings schemas are not installed");
+		return;
+	}
+
+	/* The first writes create the snapshot and the memory backend keys. */
+	a11y_settings_snapshot ();
+	option_toggle_handler (NULL, NULL);
+	option_toggle_handler (NULL, NULL);
+
+	emitter = g_object_new (test_emitter_get_type (), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (emitter, "poke", option_toggle_handler, NULL);
+	poke (emitter);
+	g_object_unref (emitter);
+}
+
+static void
+test_theme_paths_clean (void)
+{
+	GtkListStore *store;
+	GtkTreeModel *filter;
+	GObject *emitter;
+
+	if (!settings_schemas_installed ()) {
+		g_test_skip ("the MATE settings schemas are not installed");
+		return;
+	}
+
+	store = mouse_settings_themes_populate_store ();
+	filter = mouse_settings_themes_filter_new (store);
+
+	a11y_settings_snapshot ();
+	theme_select_handler (NULL, filter);
+	theme_select_handler (NULL, filter);
+
+	emitter = g_object_new (test_emitter_get_type (), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (emitter, "poke", theme_select_handler, filter);
+	poke (emitter);
+	g_object_unref (emitter);
+
+	g_object_unref (filter);
+	g_object_unref (store);
+}
+
+static void
+test_cache_growth_skipped (void)
+{
+	GObject *emitter;
+
+	alloc_accounting_add_cache (test_cache_size);
+
+	emitter = g_object_new (test_emitter_get_type (), NULL);
+	ACCOUNTED_SIGNAL_CONNECT (emitter, "poke", cache_handler, NULL);
+	poke (emitter);
+	g_object_unref (emitter);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	int status;
+
+	/* Must happen before the first GSettings is created. */
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+
+	g_test_init (&argc, &argv, NULL);
+
+	kept = g_ptr_array_new_with_free_func (g_free);
+
+	g_test_add_func ("/alloc-accounting/leak-reported", test_leak_reported);
+	g_test_add_func ("/alloc-accounting/clean-quiet", test_clean_quiet);
+	g_test_add_func ("/alloc-accounting/busy-worker-skipped", test_busy_worker_skipped);
+	g_test_add_func ("/alloc-accounting/cache-growth-skipped", test_cache_growth_skipped);
+	g_test_add_func ("/alloc-accounting/option-paths-clean", test_option_paths_clean);
+	g_test_add_func ("/alloc-accounting/theme-paths-clean", test_theme_paths_clean);
+
+	status = g_test_run ();
+
+	a11y_settings_shutdown ();
+
+	return status;
+}
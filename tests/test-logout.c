@@ -0,0 +1,283 @@
+/*************************************************************************/
+/* Copyright (C) 2015 matias <mati86dl@gmail.com>                        */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/* Drives do_logout() against fake-session-manager on a private session
+ * bus (see run-logout-harness.sh): checks the answer, the error and the
+ * timeout paths, and logs the call latency and the longest main loop
+ * stall while the call is pending. Timings depend on the load of the
+ * machine, so they are only asserted in perf mode (-m perf): the main
+ * loop never stalls for longer than one frame, and a timed out call is
+ * given up before the session manager answers. */
+
+#include <gio/gio.h>
+
+#include "mate-session.h"
+
+#define GSM_SERVICE_DBUS    "org.mate.SessionManager"
+#define GSM_PATH_DBUS       "/org/mate/SessionManager"
+#define FAKE_INTERFACE_DBUS "org.huayra.Test.FakeSessionManager"
+
+/* One frame at 60 Hz, in microseconds. */
+#define FRAME_BUDGET        (G_USEC_PER_SEC / 60)
+
+typedef struct {
+	GMainLoop *loop;
+	gboolean   done;
+	gboolean   result;
+	GError    *error;
+	gint64     begin;
+	gint64     latency;
+	gint64     last_beat;
+	gint64     max_stall;
+} LogoutRun;
+
+static GSubprocess *fake = NULL;
+static GDBusConnection *bus = NULL;
+
+static void
+fake_set_behaviour (guint    delay,
+                    gboolean fail)
+{
+	GVariant *reply;
+	GError *error = NULL;
+
+	reply = g_dbus_connection_call_sync (bus, GSM_SERVICE_DBUS, GSM_PATH_DBUS,
+	                                     FAKE_INTERFACE_DBUS, "SetBehaviour",
+	                                     g_variant_new ("(ub)", delay, fail),
+	                                     NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+	                                     NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (reply);
+}
+
+static gboolean
+logout_heartbeat (gpointer user_data)
+{
+	LogoutRun *run = user_data;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+	run->max_stall = MAX (run->max_stall, now - run->last_beat);
+	run->last_beat = now;
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+logout_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+	LogoutRun *run = user_data;
+
+	run->latency = g_get_monotonic_time () - run->begin;
+	run->result = do_logout_finish (result, &run->error);
+	run->done = TRUE;
+	g_main_loop_quit (run->loop);
+}
+
+static gboolean
+logout_cancel (gpointer user_data)
+{
+	g_cancellable_cancel (user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+logout_run (LogoutRun *run,
+            guint      cancel_after)
+{
+	GCancellable *cancellable;
+	guint heartbeat_id;
+
+	cancellable = g_cancellable_new ();
+	run->loop = g_main_loop_new (NULL, FALSE);
+
+	/* The heartbeat stands in for the frame clock of the dialog. */
+	heartbeat_id = g_timeout_add (1, logout_heartbeat, run);
+	if (cancel_after > 0)
+		g_timeout_add (cancel_after, logout_cancel, cancellable);
+
+	run->begin = run->last_beat = g_get_monotonic_time ();
+	do_logout (cancellable, logout_done, run);
+
+	/* do_logout() itself must not wait for the bus either. */
+	run->max_stall = g_get_monotonic_time () - run->begin;
+
+	g_main_loop_run (run->loop);
+
+	g_source_remove (heartbeat_id);
+	g_main_loop_unref (run->loop);
+	g_object_unref (cancellable);
+
+	g_test_message ("logout: %.1f ms, longest stall %.1f ms",
+	                run->latency / 1000.0, run->max_stall / 1000.0);
+	g_assert_true (run->done);
+	if (g_test_perf ())
+		g_assert_cmpint (run->max_stall, <, FRAME_BUDGET);
+}
+
+static void
+test_logout_answered (void)
+{
+	LogoutRun run = { 0 };
+
+	fake_set_behaviour (0, FALSE);
+	logout_run (&run, 0);
+
+	g_assert_no_error (run.error);
+	g_assert_true (run.result);
+}
+
+static void
+test_logout_slow (void)
+{
+	LogoutRun run = { 0 };
+
+	fake_set_behaviour (LOGOUT_TIMEOUT / 2, FALSE);
+	logout_run (&run, 0);
+
+	g_assert_no_error (run.error);
+	g_assert_true (run.result);
+	g_assert_cmpint (run.latency, >=, LOGOUT_TIMEOUT / 2 * 1000);
+}
+
+static void
+test_logout_refused (void)
+{
+	LogoutRun run = { 0 };
+	gchar *remote;
+
+	fake_set_behaviour (0, TRUE);
+	logout_run (&run, 0);
+
+	g_assert_false (run.result);
+	g_assert_nonnull (run.error);
+	remote = g_dbus_error_get_remote_error (run.error);
+	g_assert_cmpstr (remote, ==, "org.mate.SessionManager.Error.Failed");
+	g_free (remote);
+	g_error_free (run.error);
+}
+
+static void
+test_logout_timeout (void)
+{
+	LogoutRun run = { 0 };
+
+	fake_set_behaviour (LOGOUT_TIMEOUT * 2, FALSE);
+	logout_run (&run, 0);
+
+	g_assert_false (run.result);
+	g_assert_error (run.error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+	g_error_free (run.error);
+
+	/* Given up on time, not when the session manager finally answers. */
+	g_assert_cmpint (run.latency, >=, LOGOUT_TIMEOUT * 1000);
+	if (g_test_perf ())
+		g_assert_cmpint (run.latency, <, LOGOUT_TIMEOUT * 2 * 1000);
+}
+
+static void
+test_logout_cancelled (void)
+{
+	LogoutRun run = { 0 };
+
+	fake_set_behaviour (LOGOUT_TIMEOUT * 2, FALSE);
+	logout_run (&run, LOGOUT_TIMEOUT / 10);
+
+	g_assert_false (run.result);
+	g_assert_error (run.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_error_free (run.error);
+	if (g_test_perf ())
+		g_assert_cmpint (run.latency, <, LOGOUT_TIMEOUT * 1000);
+}
+
+static void
+fake_appeared (GDBusConnection *connection,
+               const gchar     *name,
+               const gchar     *name_owner,
+               gpointer         user_data)
+{
+	g_main_loop_quit (user_data);
+}
+
+static gboolean
+fake_start_timeout (gpointer user_data)
+{
+	g_error ("fake-session-manager did not appear on the bus");
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fake_start (void)
+{
+	GMainLoop *loop;
+	GError *error = NULL;
+	gchar *program;
+	guint watch_id, timeout_id;
+
+	bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+
+	program = g_test_build_filename (G_TEST_BUILT, "fake-session-manager", NULL);
+	fake = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, &error, program, NULL);
+	g_assert_no_error (error);
+	g_free (program);
+
+	loop = g_main_loop_new (NULL, FALSE);
+	watch_id = g_bus_watch_name_on_connection (bus, GSM_SERVICE_DBUS,
+	                                           G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                                           fake_appeared, NULL, loop, NULL);
+	timeout_id = g_timeout_add_seconds (10, fake_start_timeout, NULL);
+	g_main_loop_run (loop);
+	g_source_remove (timeout_id);
+	g_bus_unwatch_name (watch_id);
+	g_main_loop_unref (loop);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	int status;
+
+	g_test_init (&argc, &argv, NULL);
+
+	/* Never talk to the session manager of the desktop. */
+	if (g_getenv ("DBUS_SESSION_BUS_ADDRESS") == NULL) {
+		g_printerr ("no private session bus, run under run-logout-harness.sh\n");
+		return 77;
+	}
+
+	fake_start ();
+
+	g_test_add_func ("/logout/answered", test_logout_answered);
+	g_test_add_func ("/logout/slow", test_logout_slow);
+	g_test_add_func ("/logout/refused", test_logout_refused);
+	g_test_add_func ("/logout/timeout", test_logout_timeout);
+	g_test_add_func ("/logout/cancelled", test_logout_cancelled);
+
+	status = g_test_run ();
+
+	g_subprocess_force_exit (fake);
+	g_object_unref (fake);
+	g_object_unref (bus);
+
+	return status;
+}